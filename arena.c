@@ -0,0 +1,82 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 arena.c                                      */
+/* contents: bump allocator for move lists                */
+/**********************************************************/
+#include "arena.h"
+
+#define HEADER_SIZE ((sizeof(arenaBlock_t)+ARENA_ALIGN-1)/ARENA_ALIGN*ARENA_ALIGN)
+#define blockData(B) ((char*)(B)+HEADER_SIZE)
+
+THREAD_LOCAL arena_t* listArena = NULL;
+
+/* take list nodes of this thread from arena (NULL for malloc), return the arena used until now */
+arena_t* useArena(arena_t* arena) {
+	arena_t* previous = listArena;
+	listArena = arena;
+	return previous;
+}
+
+/* @post: return size bytes from arena, NULL on allocation error */
+void* arenaAlloc(arena_t* arena, size_t size) {
+	arenaBlock_t* block;
+	void* p;
+
+	size = (size+ARENA_ALIGN-1)/ARENA_ALIGN*ARENA_ALIGN;
+	while (arena->current == NULL || arena->used+size > arena->current->size) {
+		if (arena->current != NULL && arena->current->next != NULL) { /*reuse a block kept by a reset*/
+			arena->current = arena->current->next;
+			arena->used = 0;
+			continue;
+		}
+		if ((block = (arenaBlock_t*)malloc(HEADER_SIZE+ARENA_BLOCK_SIZE)) == NULL)
+			return NULL; /*allocation error code*/
+		block->next = NULL;
+		block->size = ARENA_BLOCK_SIZE;
+		if (arena->current == NULL)
+			arena->first = block;
+		else
+			arena->current->next = block;
+		arena->current = block;
+		arena->used = 0;
+	}
+	p = blockData(arena->current)+arena->used;
+	arena->used += size;
+	return p;
+}
+
+/* current position of arena, for arenaRelease */
+arenaMark_t arenaMark(arena_t* arena) {
+	arenaMark_t mark = {arena->current, arena->used};
+	return mark;
+}
+
+/* free everything allocated from arena since mark was taken */
+void arenaRelease(arena_t* arena, arenaMark_t mark) {
+	if (mark.block == NULL) { /*mark was taken before the first allocation*/
+		arenaReset(arena);
+		return;
+	}
+	arena->current = mark.block;
+	arena->used = mark.used;
+}
+
+/* free everything allocated from arena, its blocks are kept for the next allocations */
+void arenaReset(arena_t* arena) {
+	arena->current = arena->first;
+	arena->used = 0;
+}
+
+/* give arena's blocks back to the system */
+void arenaFree(arena_t* arena) {
+	arenaBlock_t* next;
+	for (arenaBlock_t* block=arena->first ; block!=NULL ; block=next) {
+		next = block->next;
+		free(block);
+	}
+	arena->first = arena->current = NULL;
+	arena->used = 0;
+}
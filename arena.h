@@ -0,0 +1,45 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 arena.h                                      */
+/* contents: bump allocator for move lists                */
+/**********************************************************/
+#include "chessprog.h"
+#ifndef ARENA_H_
+#define ARENA_H_
+
+/* While an arena is in use (see useArena), move_t and movesList_t nodes are carved out of its blocks
+ * and freeMove/freeList/freeListWithException do nothing. Whoever set the arena frees the nodes all at
+ * once with arenaReset, or down to an arenaMark with arenaRelease (miniMax_rec does so per board). */
+
+#define ARENA_BLOCK_SIZE (64*1024) /*bytes of a block, more blocks are chained as needed*/
+#define ARENA_ALIGN sizeof(void*)
+
+typedef struct arenaBlock_t {
+	struct arenaBlock_t* next;
+	size_t size; /*bytes after the header*/
+} arenaBlock_t;
+
+typedef struct {
+	arenaBlock_t* first; /*blocks are kept on reset for reuse, NULL before the first allocation*/
+	arenaBlock_t* current; /*block allocations come from*/
+	size_t used; /*bytes used in current*/
+} arena_t;
+
+typedef struct { /*position of an arena to release back to*/
+	arenaBlock_t* block;
+	size_t used;
+} arenaMark_t;
+
+extern THREAD_LOCAL arena_t* listArena; /*arena of this thread's list nodes, NULL for malloc/free*/
+
+arena_t* useArena(arena_t* arena);
+void* arenaAlloc(arena_t* arena, size_t size);
+arenaMark_t arenaMark(arena_t* arena);
+void arenaRelease(arena_t* arena, arenaMark_t mark);
+void arenaReset(arena_t* arena);
+void arenaFree(arena_t* arena);
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,150 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 attack.c                                     */
+/* contents: squares attacked by each side                */
+/**********************************************************/
+#include "attack.h"
+#include "scan.h"
+#include "tables.h"
+
+/*map of the last board asked for by this thread*/
+static THREAD_LOCAL attackMap_t nodeMap;
+
+/* add the squares attacked by the piece on (col,row) to map */
+static void addAttacks(char board[BOARD_SIZE][BOARD_SIZE], attackMap_t* map, int col, int row) {
+	char piece = board[col][row];
+	int side = pieceSide(piece), c, r, blocked;
+
+	switch (pieceType(piece)) {
+	case PAWN:
+		map->attacks[side] |= pawnAttacks[side][toSquare(col, row)];
+		return;
+	case KNIGHT:
+		map->attacks[side] |= knightAttacks[toSquare(col, row)];
+		for (unsigned long long targets=knightAttacks[toSquare(col, row)] ; targets ; targets &= targets-1) {
+			c = squareCol(firstSquare(targets));
+			r = squareRow(firstSquare(targets));
+			if (board[c][r]==EMPTY || pieceSide(board[c][r])!=side)
+				map->mobility[side]++;
+		}
+		return;
+	case KING:
+		map->attacks[side] |= kingAttacks[toSquare(col, row)];
+		return;
+	}
+	for (int d=pieceAttr(piece).firstStep ; d<pieceAttr(piece).lastStep ; d++) {
+		blocked = 0; /*mobility stops at the first piece, the attack goes on behind the opposing king*/
+		for (c=col+pieceSteps[d][0], r=row+pieceSteps[d][1] ; inBoard(c, r) ; c+=pieceSteps[d][0], r+=pieceSteps[d][1]) {
+			map->attacks[side] |= squareBit(toSquare(c, r));
+			if (board[c][r] == EMPTY) {
+				map->mobility[side] += !blocked;
+				continue;
+			}
+			if (blocked || pieceSide(board[c][r])==side || pieceType(board[c][r])!=KING) {
+				map->mobility[side] += !blocked && pieceSide(board[c][r])!=side; /*capture*/
+				break;
+			}
+			map->mobility[side]++; /*capture of the king*/
+			blocked = 1;
+		}
+	}
+}
+
+/* fill map for board from scratch */
+void computeAttackMap(char board[BOARD_SIZE][BOARD_SIZE], attackMap_t* map) {
+	int square;
+
+	memcpy(map->board, board, sizeof(map->board));
+	map->valid = 1;
+	for (int side=0 ; side<2 ; side++) {
+		map->attacks[side] = 0;
+		map->mobility[side] = 0;
+		map->king[side] = -1;
+		for (unsigned long long pieces=scanColor(board, side==0? WHITE:BLACK) ; pieces ; pieces &= pieces-1) {
+			square = firstSquare(pieces);
+			addAttacks(board, map, squareCol(square), squareRow(square));
+			if (pieceType(board[squareCol(square)][squareRow(square)]) == KING)
+				map->king[side] = square;
+		}
+	}
+}
+
+/* map of board, computed only if the last map of this thread was for another position
+ * @post: the map is valid until the next getAttackMap call of this thread */
+attackMap_t* getAttackMap(char board[BOARD_SIZE][BOARD_SIZE]) {
+	if (cachedAttackMap(board) == NULL)
+		computeAttackMap(board, &nodeMap);
+	return &nodeMap;
+}
+
+/* map of board if it's the last one computed by this thread, NULL otherwise */
+attackMap_t* cachedAttackMap(char board[BOARD_SIZE][BOARD_SIZE]) {
+	return nodeMap.valid && memcmp(nodeMap.board, board, sizeof(nodeMap.board))==0? &nodeMap:NULL;
+}
+
+/* true iff color's king is attacked on the board of map */
+int inCheck(attackMap_t* map, char color) {
+	int side = colorSide(color);
+	return map->king[side]!=-1 && isAttacked(map, 1-side, map->king[side]);
+}
+
+/* fill info for the moves of color on board */
+void computeCheckInfo(char board[BOARD_SIZE][BOARD_SIZE], char color, checkInfo_t* info) {
+	int col, row, c, r;
+	unsigned long long ray;
+	int blocker;
+	char p;
+
+	memset(info, 0, sizeof(*info));
+	info->color = color;
+	if ((info->king = getAttackMap(board)->king[colorSide(invColor(color))]) == -1)
+		return;
+	col = squareCol(info->king);
+	row = squareRow(info->king);
+	/*a pawn of color checks from the squares an opposing pawn on the king's square would attack*/
+	info->checkSquares[PAWN] = pawnAttacks[colorSide(invColor(color))][info->king];
+	info->checkSquares[KNIGHT] = knightAttacks[info->king];
+	for (int d=0 ; d<8 ; d++) { /*rook directions first (see pieceSteps)*/
+		ray = 0;
+		blocker = -1;
+		for (c=col+pieceSteps[d][0], r=row+pieceSteps[d][1] ; inBoard(c, r) ; c+=pieceSteps[d][0], r+=pieceSteps[d][1]) {
+			if (blocker == -1) /*squares up to the first piece check directly*/
+				ray |= squareBit(toSquare(c, r));
+			if ((p = board[c][r]) == EMPTY)
+				continue;
+			if (blocker != -1 || getColor(p) != color) { /*second piece, or an opposing first one*/
+				if (blocker != -1 && getColor(p) == color && (pieceType(p)==QUEEN || pieceType(p)==(d<4? ROOK:BISHOP)))
+					info->discovered |= squareBit(blocker);
+				break;
+			}
+			blocker = toSquare(c, r);
+		}
+		info->checkSquares[d<4? ROOK:BISHOP] |= ray;
+	}
+	info->checkSquares[QUEEN] = info->checkSquares[ROOK] | info->checkSquares[BISHOP];
+}
+
+/* true iff squares a, b and c are on one line */
+#define onLine(a, b, c) ((squareCol(b)-squareCol(a))*(squareRow(c)-squareRow(a)) == \
+		(squareRow(b)-squareRow(a))*(squareCol(c)-squareCol(a)))
+
+/* true iff move (of info's side, legal on board) checks the opposing king
+ * castling and promotions, where the squares the move empties matter, are played on a copy of board */
+int givesCheck(char board[BOARD_SIZE][BOARD_SIZE], checkInfo_t* info, move_t* move) {
+	int from = toSquare(move->curr.col, move->curr.row), to = toSquare(move->next->curr.col, move->next->curr.row);
+	char copy[BOARD_SIZE][BOARD_SIZE];
+
+	if (info->king == -1)
+		return 0;
+	if (move->special == NORM)
+		return (info->checkSquares[pieceType(board[move->curr.col][move->curr.row])] & squareBit(to)) || \
+				((info->discovered & squareBit(from)) && !onLine(info->king, from, to));
+	saveCastlingFlags();
+	memcpy(copy, board, sizeof(copy));
+	playMove(copy, move);
+	restoreCastlingFlags();
+	return isCheck(copy, invColor(info->color));
+}
@@ -0,0 +1,42 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 attack.h                                     */
+/* contents: squares attacked by each side                */
+/**********************************************************/
+#include "position.h"
+#ifndef ATTACK_H_
+#define ATTACK_H_
+
+/* Squares are masks with bit toSquare(col,row) set (see scan.h). A map is computed once per board
+ * position and kept until a different board is asked for, so the legality checks of a node and the
+ * scoring of a leaf share it. */
+
+#define squareBit(S) (1ULL << (S))
+#define isAttacked(M,SIDE,S) (((M)->attacks[SIDE] & squareBit(S)) != 0) /*S attacked by SIDE (0 white, 1 black)*/
+
+typedef struct {
+	char board[BOARD_SIZE][BOARD_SIZE]; /*copy of the board the map describes*/
+	char valid;
+	unsigned long long attacks[2]; /*squares white's and black's pieces attack, sliders see through the opposing king*/
+	int mobility[2]; /*squares knights, bishops, rooks and queens of each side can move to, see mobilityScore*/
+	int king[2]; /*square of each side's king, -1 if it has none*/
+} attackMap_t;
+
+typedef struct { /*what givesCheck needs to know about a position, see computeCheckInfo*/
+	char color; /*side whose moves are tested*/
+	int king; /*square of the opposing king, -1 if it has none*/
+	unsigned long long checkSquares[KING+1]; /*by piece type, squares a piece of color checks the king from*/
+	unsigned long long discovered; /*color's pieces that uncover a check by a slider of color when they leave the line*/
+} checkInfo_t;
+
+void computeAttackMap(char board[BOARD_SIZE][BOARD_SIZE], attackMap_t* map);
+attackMap_t* getAttackMap(char board[BOARD_SIZE][BOARD_SIZE]);
+attackMap_t* cachedAttackMap(char board[BOARD_SIZE][BOARD_SIZE]);
+int inCheck(attackMap_t* map, char color);
+void computeCheckInfo(char board[BOARD_SIZE][BOARD_SIZE], char color, checkInfo_t* info);
+int givesCheck(char board[BOARD_SIZE][BOARD_SIZE], checkInfo_t* info, move_t* move);
+
+#endif /* ATTACK_H_ */
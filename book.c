@@ -0,0 +1,341 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 book.c                                       */
+/* contents: opening book                                 */
+/**********************************************************/
+#include "book.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define PGN_TOKEN 256 /*longer tokens are cut*/
+#define PGN_END 0
+#define PGN_MOVE 1 /*a move, move number or result*/
+#define PGN_TAG 2 /*a tag of a game's header*/
+
+/*book mapped by bookOpen, only read by the main thread (see miniMax_env)*/
+static void* mapping = NULL;
+static size_t mappingSize = 0;
+static const bookEntry_t* entries = NULL;
+static unsigned long long entryCount = 0;
+
+/******************* probing ************************/
+
+/* map the book file at path (see book.h for its format), replacing the open book
+ * @post: return 0 on success, -1 if the file is missing or isn't a book of this version */
+int bookOpen(const char* path) {
+	const bookHeader_t* header;
+	struct stat st;
+	void* map;
+	int fd;
+
+	bookClose();
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return -1;
+	if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(bookHeader_t)) {
+		close(fd);
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); /*the mapping stays valid*/
+	if (map == MAP_FAILED)
+		return -1;
+	header = (const bookHeader_t*)map;
+	if (strncmp(header->magic, BOOK_MAGIC, sizeof(header->magic)) != 0 || header->version != BOOK_VERSION || \
+			(st.st_size-sizeof(bookHeader_t)) % sizeof(bookEntry_t) != 0 || \
+			header->count != (st.st_size-sizeof(bookHeader_t)) / sizeof(bookEntry_t)) {
+		munmap(map, st.st_size);
+		return -1;
+	}
+	mapping = map;
+	mappingSize = st.st_size;
+	entries = (const bookEntry_t*)(header+1);
+	entryCount = header->count;
+	return 0;
+}
+
+/* unmap the open book, if any */
+void bookClose() {
+	if (mapping != NULL)
+		munmap(mapping, mappingSize);
+	mapping = NULL;
+	entries = NULL;
+	entryCount = 0;
+}
+
+/* a book move of color on board, picked at random by the weights of the position's moves
+ * @post: returns a newly allocated move, NULL if there's no book, board isn't in it or on allocation error */
+move_t* bookMove(char board[BOARD_SIZE][BOARD_SIZE], char color) {
+	posState_t state;
+	unsigned long long key, first, last, mid;
+	unsigned long total = 0, r;
+	const bookEntry_t* entry;
+	move_t* move;
+	pos_t pos;
+
+	if (entries == NULL)
+		return NULL;
+	computePosState(board, &state);
+	key = positionKey(&state, color);
+	for (first=0, last=entryCount ; first<last ;) { /*first entry of key*/
+		mid = first+(last-first)/2;
+		if (entries[mid].key < key)
+			first = mid+1;
+		else
+			last = mid;
+	}
+	for (last=first ; last<entryCount && entries[last].key==key ; last++)
+		total += entries[last].weight;
+	if (total == 0)
+		return NULL;
+
+	r = (unsigned long)rand() % total; /*moves are picked as often as they were played*/
+	for (entry=entries+first ; r >= entry->weight ; r -= entry->weight, entry++);
+	pos.col = squareCol(entry->from);
+	pos.row = squareRow(entry->from);
+	if ((move = addPosToMove(NULL, pos)) == NULL)
+		return NULL; /*allocation error*/
+	pos.col = squareCol(entry->to);
+	pos.row = squareRow(entry->to);
+	if (addPosToMove(move, pos) == NULL) {
+		freeMove(move);
+		return NULL; /*allocation error*/
+	}
+	move->special = move->next->special = entry->special;
+	if (!isLegalMove(board, move, color)) { /*another position with the same key*/
+		freeMove(move);
+		return NULL;
+	}
+	return move;
+}
+
+/******************* building ************************/
+
+/* read the next token of a PGN file into token, skipping comments, variations and annotations
+ * @post: return PGN_TAG for a tag (its text is in token), PGN_MOVE for anything else, PGN_END at end of file */
+static int nextToken(FILE* fp, char token[PGN_TOKEN]) {
+	int c, n = 0, depth;
+
+	for (;;) {
+		while ((c = getc(fp)) != EOF && isspace(c));
+		switch (c) {
+		case EOF:
+			return PGN_END;
+		case '{': /*comment*/
+			while ((c = getc(fp)) != EOF && c != '}');
+			continue;
+		case ';': /*comment to the end of the line*/
+		case '%': /*escaped line*/
+			while ((c = getc(fp)) != EOF && c != '\n');
+			continue;
+		case '(': /*variation, may hold others*/
+			for (depth=1 ; depth>0 && (c = getc(fp)) != EOF ;)
+				depth += c=='('? 1 : c==')'? -1 : 0;
+			continue;
+		case '$': /*numeric annotation glyph*/
+			while ((c = getc(fp)) != EOF && isdigit(c));
+			if (c != EOF)
+				ungetc(c, fp);
+			continue;
+		case '[': /*tag, the value is quoted and may hold ']'*/
+			for (int quoted=0 ; (c = getc(fp)) != EOF && (quoted || c != ']') ;) {
+				quoted ^= c=='"';
+				if (n < PGN_TOKEN-1)
+					token[n++] = c;
+			}
+			token[n] = '\0';
+			return PGN_TAG;
+		}
+		do {
+			if (n < PGN_TOKEN-1)
+				token[n++] = c;
+		} while ((c = getc(fp)) != EOF && !isspace(c) && strchr("[]{}();$", c) == NULL);
+		if (c != EOF)
+			ungetc(c, fp);
+		token[n] = '\0';
+		return PGN_MOVE;
+	}
+}
+
+/* the legal move of color on board written as san (standard algebraic notation, as in PGN)
+ * @post: returns a newly allocated move, NULL if no move or more than one matches, or on allocation error */
+static move_t* sanMove(char board[BOARD_SIZE][BOARD_SIZE], char color, const char* san) {
+	const char* end = san+strlen(san);
+	char type = PAWN, promotion = QUEEN;
+	int castleCol = -1, toCol = 0, toRow = 0, fromCol = -1, fromRow = -1, matches = 0;
+	movesList_t *moves, *found = NULL;
+	move_t* move;
+	pos_t from, to;
+
+	while (end > san && strchr("+#!?", end[-1]) != NULL) /*check marks and annotations*/
+		end--;
+	if (strncmp(san, "O-O", 3) == 0 || strncmp(san, "0-0", 3) == 0) /*castling is the rook's move here*/
+		castleCol = end-san >= 5? 0 : BOARD_SIZE-1;
+	else {
+		if (*san != '\0' && strchr("NBRQK", *san) != NULL)
+			type = pieceType(letterPiece(tolower(*san++)));
+		if (type == PAWN && end-san >= 2 && strchr("NBRQ", end[-1]) != NULL) { /*e8=Q or e8Q*/
+			promotion = pieceType(letterPiece(tolower(end[-1])));
+			end -= end[-2]=='='? 2:1;
+		}
+		if (end-san < 2 || !inBoard(end[-2]-'a', end[-1]-'1'))
+			return NULL;
+		toCol = end[-2]-'a';
+		toRow = end[-1]-'1';
+		for (const char* s=san ; s<end-2 ; s++) { /*disambiguation, 'x' and '-' are skipped*/
+			if ('a' <= *s && *s < 'a'+BOARD_SIZE)
+				fromCol = *s-'a';
+			else if ('1' <= *s && *s < '1'+BOARD_SIZE)
+				fromRow = *s-'1';
+		}
+	}
+
+	if ((moves = getAllLegalMoves(board, color)) == NULL)
+		return NULL; /*allocation error*/
+	for (movesList_t* next=moves ; next!=NULL && next->curr!=NULL ; next=next->next) {
+		move = next->curr;
+		from = move->curr;
+		to = move->next->curr;
+		if (castleCol != -1? move->special!=CASTLE || from.col!=castleCol : \
+				move->special==CASTLE || pieceType(board[from.col][from.row])!=type || \
+				to.col!=toCol || to.row!=toRow || (fromCol!=-1 && from.col!=fromCol) || \
+				(fromRow!=-1 && from.row!=fromRow) || (move->special!=NORM && pieceType(move->special)!=promotion))
+			continue;
+		found = next;
+		matches++;
+	}
+	if (matches != 1) {
+		freeList(moves);
+		return NULL;
+	}
+	move = found->curr;
+	freeListWithException(moves, move);
+	return move;
+}
+
+/* order of the entries in a book file */
+static int compareEntries(const void* a, const void* b) {
+	const bookEntry_t *x = (const bookEntry_t*)a, *y = (const bookEntry_t*)b;
+	if (x->key != y->key)
+		return x->key < y->key? -1:1;
+	if (x->from != y->from)
+		return x->from - y->from;
+	if (x->to != y->to)
+		return x->to - y->to;
+	return x->special - y->special;
+}
+
+/* sort entries, merge those of the same move and write them to a book file at path
+ * @post: return the number of entries written, -1 if the file can't be written */
+static long writeBook(const char* path, bookEntry_t* buffer, size_t count) {
+	bookHeader_t header;
+	size_t n = 0;
+	FILE* fp;
+
+	qsort(buffer, count, sizeof(bookEntry_t), compareEntries);
+	for (size_t i=0 ; i<count ; i++) {
+		if (n > 0 && compareEntries(&buffer[n-1], &buffer[i]) == 0) {
+			buffer[n-1].weight += buffer[n-1].weight<BOOK_MAX_WEIGHT;
+			continue;
+		}
+		buffer[n++] = buffer[i];
+	}
+
+	memset(&header, 0, sizeof(header));
+	strncpy(header.magic, BOOK_MAGIC, sizeof(header.magic));
+	header.version = BOOK_VERSION;
+	header.count = n;
+	if ((fp = fopen(path, "wb")) == NULL)
+		return -1;
+	if (fwrite(&header, sizeof(header), 1, fp) != 1 || fwrite(buffer, sizeof(bookEntry_t), n, fp) != n) {
+		fclose(fp);
+		return -1;
+	}
+	return fclose(fp)==0? (long)n : -1;
+}
+
+/* build a book file at bookPath from the games of the PGN file at pgnPath. Each game is followed from the
+ * start position for up to BOOK_PLIES plies, until a move this project's rules don't allow (a pawn's double
+ * step, en passant) or that can't be read. Games set up from a FEN position are skipped.
+ * @post: return the number of entries written, -1 if a file can't be read or written or on allocation error */
+long bookBuild(const char* pgnPath, const char* bookPath) {
+	char board[BOARD_SIZE][BOARD_SIZE], token[PGN_TOKEN], *s, color = WHITE;
+	bookEntry_t *buffer = NULL, *tmp;
+	size_t count = 0, size = 0;
+	int type, started = 0, following = 0, setUp = 0;
+	unsigned plies = 0;
+	posState_t state;
+	move_t* move;
+	long result;
+	FILE* fp;
+	saveCastlingFlags();
+
+	if ((fp = fopen(pgnPath, "r")) == NULL)
+		return -1;
+	while ((type = nextToken(fp, token)) != PGN_END) {
+		if (type == PGN_TAG) { /*header of the next game*/
+			setUp = started? 0:setUp;
+			started = 0;
+			setUp = setUp || strncmp(token, "FEN ", 4) == 0 || strncmp(token, "SetUp \"1\"", 9) == 0;
+			continue;
+		}
+		if (strcmp(token, "1-0")==0 || strcmp(token, "0-1")==0 || strcmp(token, "1/2-1/2")==0 || strcmp(token, "*")==0) {
+			started = setUp = 0;
+			continue;
+		}
+		for (s=token ; isdigit(*s) ; s++); /*move number, "12." or "12..."*/
+		if (*s == '.')
+			while (*s == '.')
+				s++;
+		else
+			s = token;
+		if (*s == '\0')
+			continue;
+		if (!started) {
+			init_board(board);
+			wk=0; wlr=0; wrr=0; bk=0; blr=0; brr=0;
+			color = WHITE;
+			plies = 0;
+			following = !setUp;
+			started = 1;
+		}
+		if (!following || plies >= BOOK_PLIES)
+			continue;
+		if ((move = sanMove(board, color, s)) == NULL) {
+			following = 0;
+			continue;
+		}
+		if (count == size) {
+			size = size? 2*size : 1024;
+			if ((tmp = (bookEntry_t*)realloc(buffer, size*sizeof(bookEntry_t))) == NULL) {
+				freeMove(move);
+				free(buffer);
+				fclose(fp);
+				restoreCastlingFlags();
+				return -1; /*allocation error*/
+			}
+			buffer = tmp;
+		}
+		computePosState(board, &state);
+		memset(&buffer[count], 0, sizeof(bookEntry_t));
+		buffer[count].key = positionKey(&state, color);
+		buffer[count].weight = 1;
+		buffer[count].from = toSquare(move->curr.col, move->curr.row);
+		buffer[count].to = toSquare(move->next->curr.col, move->next->curr.row);
+		buffer[count].special = move->special;
+		count++;
+		playMove(board, move);
+		freeMove(move);
+		color = invColor(color);
+		plies++;
+	}
+	result = ferror(fp)? -1 : writeBook(bookPath, buffer, count);
+	fclose(fp);
+	free(buffer);
+	restoreCastlingFlags();
+	return result;
+}
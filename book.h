@@ -0,0 +1,48 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 book.h                                       */
+/* contents: opening book                                 */
+/**********************************************************/
+#include "chessprog.h"
+#include "position.h"
+#ifndef BOOK_H_
+#define BOOK_H_
+
+/* The book is a file of moves by position, memory-mapped when opened, so a lookup is a binary search
+ * with no reading or parsing. It's built from a PGN collection by "chessprog book <pgn> <book>".
+ *
+ * Book file, native byte order:
+ *   bookHeader_t, then bookEntry_t entries[count] sorted by key, then by from, to and special.
+ * Keys are positionKey's, they stay valid as long as the zobrist keys of position.c don't change
+ * (BOOK_VERSION is raised when they do). */
+
+#define BOOK_MAGIC "CNBOOK"
+#define BOOK_VERSION 1
+#define BOOK_FILE "chessnut.book" /*opened by main if it exists, see the "book_file" setting*/
+#define BOOK_PLIES 24 /*moves after the first BOOK_PLIES plies of a game aren't added*/
+#define BOOK_MAX_WEIGHT 0xFFFF
+
+typedef struct {
+	char magic[8]; /*BOOK_MAGIC, zero padded*/
+	unsigned version;
+	unsigned unused;
+	unsigned long long count; /*entries following the header*/
+} bookHeader_t;
+
+typedef struct { /*a move of a position*/
+	unsigned long long key; /*positionKey of the position, with the side to move*/
+	unsigned short weight; /*games the move was played in, BOOK_MAX_WEIGHT at most*/
+	unsigned char from, to; /*squares, see toSquare*/
+	char special; /*as in move_t*/
+	char unused[3];
+} bookEntry_t;
+
+int bookOpen(const char* path);
+void bookClose();
+move_t* bookMove(char board[BOARD_SIZE][BOARD_SIZE], char color);
+long bookBuild(const char* pgnPath, const char* bookPath);
+
+#endif /* BOOK_H_ */
@@ -9,6 +9,17 @@
 #include "chessprog.h"
 #include "console.h"
 #include "gui.h"
+#include "ponder.h"
+#include "minimax.h"
+#include "position.h"
+#include "scan.h"
+#include "attack.h"
+#include "arena.h"
+#include "pool.h"
+#include "movepick.h"
+#include "tables.h"
+#include "book.h"
+#include "tablebase.h"
 
 /* GLOBALS */
 char gameBoard[BOARD_SIZE][BOARD_SIZE]; /*[cols][rows]*/
@@ -17,12 +28,56 @@ unsigned minimaxDepth = 1;
 char userColor = WHITE;
 char gameMode = PVP;
 char nextPlayer = WHITE;
-char wk=0, wlr=0, wrr=0, bk=0, blr=0, brr=0; /* flags for castling state */
+char ponderMode = PONDER; /*think on the user's time, see ponder.h*/
+char statsLog = STATS_LOG; /*log search counters for every computer move*/
+THREAD_LOCAL char wk=0, wlr=0, wrr=0, bk=0, blr=0, brr=0; /* flags for castling state */
+
+/*(M)pawn = 1 , kNight = 3 , Bishop = 3 , Rook = 5, Queen = 9, King=400. BEST scores knight and rook better*/
+const pieceInfo_t pieceInfo[PIECE_CODES] = {
+	[EMPTY]    = {' ', -1,   0,  0, 0, 0, 0},
+	[W_PAWN]   = {'m',  0,   1, 10, 0, 0, 0},
+	[W_KNIGHT] = {'n',  1,   3, 33, 0, 0, 1},
+	[W_BISHOP] = {'b',  2,   3, 34, 4, 8, 2},
+	[W_ROOK]   = {'r',  3,   5, 50, 0, 4, 4},
+	[W_QUEEN]  = {'q',  4,   9, 90, 0, 8, 3},
+	[W_KING]   = {'k',  5, 400,  0, 0, 0, 5},
+	[B_PAWN]   = {'M',  6,   1, 10, 0, 0, 0},
+	[B_KNIGHT] = {'N',  7,   3, 33, 0, 0, 1},
+	[B_BISHOP] = {'B',  8,   3, 34, 4, 8, 2},
+	[B_ROOK]   = {'R',  9,   5, 50, 0, 4, 4},
+	[B_QUEEN]  = {'Q', 10,   9, 90, 0, 8, 3},
+	[B_KING]   = {'K', 11, 400,  0, 0, 0, 5},
+	[7]={' ', -1}, [8]={' ', -1}, [15]={' ', -1} /*unused codes, 8 is BLACK_PIECE with no type*/
+};
 
 int main(int argc, char* argv[]) {
 	int ret=1;
 	setvbuf(stdout, NULL, _IONBF, 0); /*Eclipse console bug workaround*/
 	srand(1); /* for pseudo-random move selection in minimax */
+	initPosition(); /* zobrist keys */
+
+	if (argc==4 && strcmp(argv[1], "book")==0) { /*chessprog book <pgn> <book>: build an opening book*/
+		long entries = bookBuild(argv[2], argv[3]);
+		if (entries == -1)
+			printf("Wrong file name\n");
+		else
+			printf("Book of %ld moves written to %s\n", entries, argv[3]);
+		return entries==-1? 1:0;
+	}
+	if (argc>=3 && strcmp(argv[1], "tablebase")==0) { /*chessprog tablebase <name>...: generate endgame tables*/
+		for (int i=2 ; i<argc ; i++) {
+			if (tbGenerate(TB_DIR, argv[i]) == -1) {
+				printf("Failed to generate %s\n", argv[i]);
+				tbClose();
+				return 1;
+			}
+			printf("Tablebase %s written to %s\n", argv[i], TB_DIR);
+		}
+		tbClose();
+		return 0;
+	}
+	bookOpen(BOOK_FILE); /*play without a book if there is none*/
+	tbOpen(TB_DIR); /*nor tables*/
 
 	assert(argc<=2);
 	if (argc==1 || strcmp(argv[1], "console")==0) {
@@ -64,6 +119,8 @@ void playMove(char board[BOARD_SIZE][BOARD_SIZE], move_t* move) {
 	pos_t from=move->curr, to=move->next->curr;
 	char piece = board[from.col][from.row];
 
+	if (board == posState.board)
+		updatePosState(board, move);
 	setPiece(board, from, EMPTY); /*take piece from*/
 	setPiece(board, to, piece); /*set piece to*/
 	updateCastlingFlags(piece, from);
@@ -110,9 +167,7 @@ void updateCastlingFlags(char piece, pos_t pos) {
  * return -1 as allocation error code
  */
 int evalBoard(char board[BOARD_SIZE][BOARD_SIZE], char nextPlayer) {
-	int hasMoves, check = isCheck(board, nextPlayer);
-	if (check == -1) /*allocation error in isCheck*/
-		return -1;
+	int hasMoves, check = inCheck(getAttackMap(board), nextPlayer); /*map is reused by canMove and the scoring*/
 	hasMoves = canMove(board, nextPlayer);
 	switch (hasMoves) {
 	case -1: /*allocation error*/
@@ -124,14 +179,17 @@ int evalBoard(char board[BOARD_SIZE][BOARD_SIZE], char nextPlayer) {
 	}
 }
 
-/* return 1 if playerColor's king is threatened, else 0 */
+/* return 1 if playerColor's king is threatened, else 0
+ * the attack map is used if board has one, a single position (after a move) is cheaper to walk from the king */
 int isCheck(char board[BOARD_SIZE][BOARD_SIZE], char playerColor) {
-	int i, a, b, c, d, row, col;
 	int flagColor;
 	pos_t kingPos, pos;
 	char color = playerColor;
+	attackMap_t* map = cachedAttackMap(board);
 	flagColor = (color==WHITE) ? 1 : -1;
 
+	if (map != NULL)
+		return inCheck(map, color);
 	kingPos = getKingPos(board, color);
 
 	for (int row=kingPos.row-1 ; row<=kingPos.row+1 ; row+=2) {
@@ -213,28 +271,8 @@ int isCheck(char board[BOARD_SIZE][BOARD_SIZE], char playerColor) {
 	}
 
 	/*Knight - 8 Positions*/
-	a=1;
-	b=2;
-	c=2;
-	d=4;
-	for(i=0;i<2;i++){ /*2 Iterations - switching rows with columns*/
-		for (row=kingPos.row-b ; row<=kingPos.row+b ; row+=d) {  /*2 Iterations*/
-			for (col=kingPos.col-a ; col<=kingPos.col+a ; col+=c) {  /*2 Iterations*/
-				/*Condition: inBoard*/
-				if(inBoard(col, row) && color!=getColor(board[col][row])){
-					switch(board[col][row]){
-						case W_KNIGHT:
-						case B_KNIGHT:
-							return 1;
-					}
-				}
-			}
-		}
-	a=2;
-	b=1;
-	c=4;
-	d=2;
-	}
+	if (knightAttacks[toSquare(kingPos.col, kingPos.row)] & scanPiece(board, color==WHITE? B_KNIGHT:W_KNIGHT))
+		return 1;
 
 	return 0;
 }
@@ -263,673 +301,64 @@ int canMove(char board[BOARD_SIZE][BOARD_SIZE], char player) {
  * @post: on empty list (0 moves) return: list with size 0
  */
 movesList_t* getAllLegalMoves(char board[BOARD_SIZE][BOARD_SIZE], char color){
-	char c;
-	unsigned i, j;
-	pos_t pos;
-	movesList_t *movesList, *tmp_moves;
-
-	movesList = initEmptyList();
-	if (movesList == NULL)
-		return NULL; /*allocation error code*/
-
-	for (i = 0; i < BOARD_SIZE; i++){ /* rows - left to right */
-		for (j = 0; j < BOARD_SIZE; j++){ /* columns - left to right */
-			c = board[i][j]; /* w B */
-			if (c != EMPTY && color == getColor(c)){ /* only if piece is in given color */
-				pos.col = i;
-				pos.row = j;
-				tmp_moves = getMovesForPiece(board, pos);
-				if (tmp_moves == NULL){
-					freeList(movesList);
-					freeList(tmp_moves);
-					return NULL;
-				}
-				if (c == W_KING || c == B_KING) /*eliminates double castling move*/
-					deleteCastlingMoves(tmp_moves);
-
-				movesList = extendMovesList(movesList, tmp_moves);
-			}
-		}
-	}
-
-	return movesList;
-}
-
-/* delete castling moves from list if there are any */
-void deleteCastlingMoves(movesList_t *tmp_moves){
-	movesList_t *head;
-	movesList_t* keepNext;
-
-	if (isEmpty(tmp_moves))
-		return;
-
-	head = tmp_moves;
-	while (head != NULL){ /* Deleting Moves with special == CASTLE */
-		keepNext = head->next;
-		if (head->curr->special == CASTLE)
-		{
-			if (head==tmp_moves && keepNext!=NULL) /*about to delete first move*/
-				keepNext = head;  /*head of list will contain second element, so that's our next move*/
-			deleteMoveFromList(head->curr,tmp_moves);
-		}
-		head = keepNext;
-	}
-
+	mmStats.moveGens++;
+	return generateMoves(board, color); /*with generators specialised for each side, see movepick.c*/
 }
 
 /* @pre: There is a piece in the given position
- * @post: if recieves a move of length 1, treats same as empty movesList
+ * @post: on allocation error return: NULL
  */
 movesList_t* getMovesForPiece(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos){
-
-	movesList_t *allMoves;
-	char piece, color;
-	piece = board[startPos.col][startPos.row];
-	color = getColor(piece);
-
-	switch (piece) {
-	case W_PAWN:
-	case B_PAWN:
-		allMoves = getPawnMove(board, startPos, color);
-		break;
-	case W_KNIGHT:
-	case B_KNIGHT:
-		allMoves = getKnightMove(board, startPos, color);
-		break;
-	case W_BISHOP:
-	case B_BISHOP:
-		allMoves = getBishopMove(board, startPos, color);
-		break;
-	case W_ROOK:
-	case B_ROOK:
-		allMoves = getRookMove(board, startPos, color);
-		break;
-	case W_QUEEN:
-	case B_QUEEN:
-		allMoves = getQueenMove(board, startPos, color);
-		break;
-	case W_KING:
-	case B_KING:
-		allMoves = getKingMove(board, startPos, color);
-		break;
-	}
-
-	if (allMoves == NULL)
-		return NULL; /*allocation error*/
-
-	keepAllLegalMoves(board, allMoves, color);
-
-	if (isEmpty(allMoves) || allMoves->curr->size<2) { /*handles illegal move return*/
-		freeList(allMoves);
-		allMoves = initEmptyList();
-	}
-
-	return allMoves;
-}
-
-movesList_t* getPawnMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color){
-
-	int col, row;
-	move_t *captureR = NULL, *captureL = NULL, *movement = NULL;
-	movesList_t* answer, *promotions;
-	pos_t pos;
-
-	answer = initEmptyList();
-	captureR = addPosToMove(captureR, startPos);
-	captureL = addPosToMove(captureL, startPos);
-	movement = addPosToMove(movement, startPos);
-	if (captureR == NULL || captureL == NULL || movement == NULL || answer == NULL) {
-		freeMove(captureR);
-		freeMove(captureL);
-		freeMove(movement);
-		freeList(answer);
-		return NULL; /*allocation error code*/
-	}
-
-	if (color == WHITE){
-		if (startPos.row<BOARD_SIZE - 2){ /* Not at the top 2 rows of the board */
-			row = startPos.row + 1; /* up */
-			col = startPos.col;
-
-			/*straight movement*/
-			if (board[col][row] == EMPTY) {
-				pos.col = col;
-				pos.row = row;
-				if (addPosToMove(movement, pos) == NULL){
-					badAllocMoveList(captureL, captureR, answer);
-				}
-				answer = addMoveToMoves(answer, movement);
-			}
-
-			/*eliminations*/
-			col = startPos.col + 1; /* right */
-			if (inBoard(col, row) && board[col][row] != EMPTY && getColor(board[col][row]) != color) { /* not at right end of board && occupied */
-				pos.col = col;
-				pos.row = row;
-				if (addPosToMove(captureR, pos) == NULL){
-					badAllocMoveList(captureL, movement, answer);
-				}
-				answer = addMoveToMoves(answer, captureR);
-			}
-			col = startPos.col - 1; /* left */
-			if (inBoard(col, row) && board[col][row] != EMPTY && getColor(board[col][row]) != color) { /* not at left end of board && occupied */
-				pos.col = col;
-				pos.row = row;
-				if (addPosToMove(captureL, pos) == NULL){
-					badAllocMoveList(captureR, movement, answer);
-				}
-				answer = addMoveToMoves(answer, captureL);
-			}
-
-		}
-		else if (startPos.row == BOARD_SIZE - 2){ /* In second last row - before promotion */
-			if ((promotions = getPawnPromotions(board, startPos, color)) == NULL) {
-				freeMove(captureR);
-				freeMove(captureL);
-				freeMove(movement);
-				return NULL;
-			}
-			answer = extendMovesList(answer, promotions);
-		}
-	}
-	else { /* color == BLACK */
-		if (startPos.row>1){ /* Not at the bottom 2 rows of the board */
-			row = startPos.row - 1; /* down */
-			col = startPos.col;
-
-			/*straight movement*/
-			if (board[col][row] == EMPTY) {
-				pos.col = col;
-				pos.row = row;
-				if (addPosToMove(movement, pos) == NULL){
-					badAllocMoveList(captureL, captureR, answer);
-				}
-				answer = addMoveToMoves(answer, movement);
-			}
-
-			/*eliminations*/
-			col = startPos.col + 1; /* right */
-			if (inBoard(col, row) && board[col][row] != EMPTY && getColor(board[col][row]) != color) { /* not at right end of board && occupied */
-				pos.col = col;
-				pos.row = row;
-				if (addPosToMove(captureR, pos) == NULL){
-					badAllocMoveList(captureL, movement, answer);
-				}
-				answer = addMoveToMoves(answer, captureR);
-			}
-			col = startPos.col - 1; /* left */
-			if (inBoard(col, row) && board[col][row] != EMPTY && getColor(board[col][row]) != color) { /* not at left end of board && occupied */
-				pos.row = row;
-				pos.col = col;
-				if (addPosToMove(captureL, pos) == NULL){
-					badAllocMoveList(captureR, movement, answer);
-				}
-				answer = addMoveToMoves(answer, captureL);
-			}
-
-		}
-		else if (startPos.row == 1) { /* In second last row - before promotion */
-			if ((promotions = getPawnPromotions(board, startPos, color)) == NULL) {
-				freeMove(captureR);
-				freeMove(captureL);
-				freeMove(movement);
-				return NULL;
-			}
-			answer = extendMovesList(answer, promotions);
-		}
-	}
-
-	if (captureL->size == 1)
-		freeMove(captureL);
-	if (captureR->size == 1)
-		freeMove(captureR);
-	if (movement->size == 1)
-		freeMove(movement);
-
-	return answer;
-}
-
-/* Deals with promotion+elimination or just promotion.
-* @pre: (startPos.row==1 && color==BLACK) || (startPos.row==BOARD_SIZE-1 && color==WHITE)
-* @post: Will return a movesList_t* of size 4-12
-*/
-movesList_t* getPawnPromotions(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color){
-
-	int i;
-	move_t *promQ, *promR, *promB, *promN;
-	movesList_t* answer = initEmptyList();
-	pos_t pos;
-	int colFlag =  (color == WHITE) ? 1 : -1;
-	char p;
-
-	if (answer==NULL)
-		return NULL; /*allocation error code*/
-
-	for (i = -1; i<2; i++){
-		/* ((board[pos.col][pos.row]) != EMPTY) || (i == 0) */
-		pos.row = startPos.row + colFlag; /* WHITE - up, BLACK - down */
-		pos.col = startPos.col + i;
-		p = board[pos.col][pos.row];
-		if ((i == 0 && p == EMPTY) || (i != 0 && inBoard(pos.col, pos.row) && p != EMPTY && getColor(p) != color)) {
-			/*Creating 4 new moves*/
-			promQ = addPosToMove(NULL, startPos);
-			promR = addPosToMove(NULL, startPos);
-			promB = addPosToMove(NULL, startPos);
-			promN = addPosToMove(NULL, startPos);
-			if (promQ == NULL || promR == NULL || promB == NULL || promN == NULL) {
-				freeMove(promQ);
-				freeMove(promR);
-				freeMove(promB);
-				freeMove(promN);
-				freeList(answer);
-				return NULL; /*allocation error code*/
-			}
-			/*Building 4 promotion moves*/
-			addPosToMove(promQ, pos);
-			addPosToMove(promR, pos);
-			addPosToMove(promB, pos);
-			addPosToMove(promN, pos);
-			/*Updating special fields in promotion moves - for both nodes*/
-			promQ->special = promQ->next->special = color == WHITE ? W_QUEEN : B_QUEEN;
-			promR->special = promR->next->special = color == WHITE ? W_ROOK : B_ROOK;
-			promB->special = promB->next->special = color == WHITE ? W_BISHOP : B_BISHOP;
-			promN->special = promN->next->special = color == WHITE ? W_KNIGHT : B_KNIGHT;
-			/*Adding promotion moves to answer*/
-			answer = addMoveToMoves(answer, promQ);
-			answer = addMoveToMoves(answer, promR);
-			answer = addMoveToMoves(answer, promB);
-			answer = addMoveToMoves(answer, promN);
-		}
-	}
-
-	return answer;
+	return generatePieceMoves(board, toSquare(startPos.col, startPos.row)); /*the search's generators, see movepick.c*/
 }
 
-movesList_t* getBishopMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color) {
-	move_t* move = NULL;
-	movesList_t* answer = NULL, *tmpList = NULL;
-	pos_t pos;
-
-	answer = initEmptyList();
-	if (answer == NULL)
-		return NULL;
-
-	for (int row = startPos.row - 1; row <= startPos.row + 1; row += 2) {
-		for (int col = startPos.col - 1; col <= startPos.col + 1; col += 2) {
-			pos.col = col; pos.row = row;
-
-			/*advance upon diagonal to find all empty spots*/
-			/*Condition: [inBoard] && [empty || opponent] */
-			for (move = NULL, tmpList = NULL; LEGAL; move = NULL, tmpList = NULL) {
-
-				if ((move = addPosToMove(move, pos)) == NULL) {
-					freeList(answer);
-					return NULL; /*allocation error*/
-				}
-				if ((tmpList = addMoveToMoves(answer, move)) == NULL) {
-					freeList(answer);
-					freeMove(move);
-					return NULL; /*allocation error*/
-				}
-
-				answer = tmpList;
-
-				if (board[pos.col][pos.row] != EMPTY)
-					break;
-
-				/*advance upon diagonal*/
-				pos.row += pos.row>startPos.row ? 1 : -1;
-				pos.col += pos.col>startPos.col ? 1 : -1;
-
-			}
-		}
-	}
+/* true iff a piece leaving from can uncover a line to the king on square king */
+#define onKingLine(king, from) (squareCol(king)==(from).col || squareRow(king)==(from).row || \
+		abs(squareCol(king)-(from).col) == abs(squareRow(king)-(from).row))
 
-	/*Push startPos to the beggining of all the moves in answer*/
-	if (!isEmpty(answer)) {
-		if ((tmpList = addPosToStart(answer, startPos)) == NULL) {
-			freeList(answer);
-			return NULL; /*allocation error*/
-		}
-	}
-
-	return answer;
-}
-
-movesList_t* getRookMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color) {
-	move_t* move = NULL;
-	movesList_t* answer = NULL, *tmpList = NULL, *castling;
-	pos_t pos;
-
-	answer = initEmptyList();
-	if (answer == NULL)
-		return NULL;
-
-	for (int row = startPos.row - 1; row <= startPos.row + 1; row += 1) {
-		for (int col = startPos.col - 1; col <= startPos.col + 1; col += 1) {
-			pos.col = col; pos.row = row;
-			/*Only for same row/colums but not both simultaneously*/
-			if (!(col == startPos.col&&row == startPos.row) && ((col == startPos.col) || (row == startPos.row))) {
-				/*advance upon row/colums to find all empty spots*/
-				/*Condition: [inBoard] && [empty || opponent)] */
-				for (move = NULL, tmpList = NULL; LEGAL; move = NULL, tmpList = NULL) {
-
-					if ((move = addPosToMove(move, pos)) == NULL) {
-						freeList(answer);
-						return NULL; /*allocation error*/
-					}
-					if ((tmpList = addMoveToMoves(answer, move)) == NULL) {
-						freeList(answer);
-						freeMove(move);
-						return NULL; /*allocation error*/
-					}
-
-					answer = tmpList;
-
-					if (board[pos.col][pos.row] != EMPTY)
-						break;
-
-					/*advance on row/column*/
-					if (pos.row != startPos.row)
-						pos.row += (pos.row>startPos.row) ? 1 : -1;  /* up:down */
-					else /*if (pos.col != startPos.col)*/
-						pos.col += (pos.col>startPos.col) ? 1 : -1;  /* right:left */
-				}
-			}
-		}
-	}
-
-	/*Push startPos to the beggining of all the moves in answer*/
-	if (!isEmpty(answer)) {
-		if ((tmpList = addPosToStart(answer, startPos)) == NULL) {
-			freeList(answer);
-			return NULL; /*allocation error*/
-		}
-	}
-
-	/*Adding Castling moves*/
-	if ((castling = getCastlingMoves(board, color)) == NULL){
-		freeList(answer);
-		freeMove(move);
-		return NULL;
-	}
-
-	if (DEBUG){
-		printf("\n");
-		printMovesList(castling);
-		printf("\n");
-	}
-	/*keep only castling move for THIS rook*/
-	if (castling->size==0) {} /*do nothing*/
-	else if (castling->size==1) { /*Make sure it's the right one*/
-		if(castling->curr->curr.col!=startPos.col){ /*if not - initEmptyList*/
-			freeList(castling);
-			castling = initEmptyList();
-		}
-	} else { /*delete the surplus move*/
-		if (castling->curr->curr.col!=startPos.col) /*first move is surplus*/
-			deleteMoveFromList(castling->curr,castling);
-		else /*second move is surplus*/
-			deleteMoveFromList(castling->next->curr,castling);
-	}
-
-	if ((tmpList = extendMovesList(answer, castling)) == NULL) {
-		freeList(answer);
-		freeMove(move);
-		freeList(castling);
-		return NULL; /*allocation error*/
-	}
-
-	return answer;
-}
-
-/* queen_moves = rook_moves + bishop_moves - castling_moves */
-movesList_t* getQueenMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color) {
-	movesList_t* answer = NULL, *rook = NULL, *bishop = NULL;
-
-	if ((bishop = getBishopMove(board, startPos, color)) == NULL) {
-		return NULL; /*allocation error*/
-	}
-
-	if ((rook = getRookMove(board, startPos, color)) == NULL) {
-		freeList(bishop);
-		return NULL; /*allocation error*/
-	}
-
-	if ((answer = extendMovesList(rook, bishop)) == NULL) {
-		freeList(bishop);
-		freeList(rook);
-		return NULL; /*allocation error*/
-	}
-
-	deleteCastlingMoves(answer);
-
-	return answer;
-}
-
-movesList_t* getKingMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color) {
-	move_t* move = NULL;
-	movesList_t* answer = NULL, *tmpList = NULL, *castling;
-	pos_t pos;
-
-	answer = initEmptyList();
-	if (answer == NULL)
-		return NULL; /*allocation error*/
-
-	for (int row = startPos.row - 1; row <= startPos.row + 1; row += 1) {
-		for (int col = startPos.col - 1; col <= startPos.col + 1; col += 1) {
-			pos.col = col; pos.row = row;
-			move = NULL; tmpList = NULL;
-			/*Condition: inBoard && pos != startPos && [empty || opponent]*/
-			if (LEGAL && !(col == startPos.col&&row == startPos.row)){
-				if ((move = addPosToMove(move, pos)) == NULL) {
-					freeList(answer);
-					return NULL; /*allocation error*/
-				}
-				if ((tmpList = addMoveToMoves(answer, move)) == NULL) {
-					freeList(answer);
-					freeMove(move);
-					return NULL; /*allocation error*/
-				}
-				answer = tmpList;
-			}
-		}
-	}
-
-	/*Push startPos to the beggining of all the moves in answer*/
-	if (!isEmpty(answer)) {
-		if ((tmpList = addPosToStart(answer, startPos)) == NULL) {
-			freeList(answer);
-			return NULL; /*allocation error*/
-		}
-	}
-
-	/*Adding Castling moves*/
-	if ((castling = getCastlingMoves(board, color)) == NULL){
-		freeList(answer);
-		freeMove(move);
-		return NULL; /*allocation error*/
-	}
-	if ((tmpList = extendMovesList(castling, answer)) == NULL) {
-		freeList(answer);
-		freeMove(move);
-		freeList(castling);
-		return NULL; /*allocation error*/
-	}
-
-	answer = tmpList;
-
-	return answer;
-}
-
-/*Will return 0, 1 or 2 possible castling moves in respect to color*/
-movesList_t* getCastlingMoves(char board[BOARD_SIZE][BOARD_SIZE], char color){
-	move_t* move = NULL;
-	movesList_t* answer = NULL, *tmpList = NULL;
-	pos_t pos;
-	char lastMove[BOARD_SIZE], k, r, l, kingPiece;
-	int i, row;
-
-	answer = initEmptyList();
-	/*Keeping last move */
-	row = color == WHITE ? 0 : BOARD_SIZE - 1;
-	for (i = 0; i<BOARD_SIZE; i++)
-		lastMove[i] = board[i][row];
-
-	/*flags*/
-	k = color == WHITE ? wk : bk; /*king*/
-	r = color == WHITE ? wrr : brr; /*right rook*/
-	l = color == WHITE ? wlr : blr; /*left rook*/
-
-	kingPiece = color == WHITE ? W_KING : B_KING;
-
-	if (!k){
-		/*Right*/
-		if (!r && board[5][row] == EMPTY && board[6][row] == EMPTY && !isCheck(board, color)){ /*Empty & not Check*/
-			board[4][row] = EMPTY;
-			board[5][row] = kingPiece;
-			if (!isCheck(board, color)){
-				board[5][row] = EMPTY;
-				board[6][row] = kingPiece;
-				if (!isCheck(board, color)){ /*a legal casteling move will be added*/
-					pos.col = 7;
-					pos.row = row;
-					if ((move = addPosToMove(move, pos)) == NULL) {
-						freeList(answer);
-						return NULL; /*allocation error*/
-					}
-					pos.col = 5;
-					pos.row = row;
-					if ((addPosToMove(move, pos)) == NULL) {
-						freeList(answer);
-						freeMove(move);
-						return NULL; /*allocation error*/
-					}
-					move->special = move->next->special = CASTLE;
-					if ((tmpList = addMoveToMoves(answer, move)) == NULL) {
-						freeList(answer);
-						freeMove(move);
-						return NULL; /*allocation error*/
-					}
-
-					answer = tmpList;
-				}
-			}
-		}
-
-		/*Restoring the board for next move*/
-		for (i = 0; i<BOARD_SIZE; i++)
-			board[i][row] = lastMove[i];
-		move = NULL;
-
-		/*Left*/
-		if (!l && board[2][row] == EMPTY && board[3][row] == EMPTY && !isCheck(board, color)){ /*Empty & not Check*/
-			board[4][row] = EMPTY;
-			board[3][row] = kingPiece;
-			if (!isCheck(board, color)){
-				board[3][row] = EMPTY;
-				board[2][row] = kingPiece;
-				if (!isCheck(board, color)){
-					pos.col = 0;
-					pos.row = row;
-					if ((move = addPosToMove(move, pos)) == NULL) { /*a legal casteling move will be added*/
-						freeList(answer);
-						return NULL; /*allocation error*/
-					}
-					pos.col = 3;
-					pos.row = row;
-					if ((addPosToMove(move, pos)) == NULL) {
-						freeList(answer);
-						freeMove(move);
-						return NULL; /*allocation error*/
-					}
-					move->special = move->next->special = CASTLE;
-					if ((tmpList = addMoveToMoves(answer, move)) == NULL) {
-						freeList(answer);
-						freeMove(move);
-						return NULL; /*allocation error*/
-					}
-
-					answer = tmpList;
-				}
-			}
-		}
-	}
-
-	/*Restoring the board for next move*/
-	for (i = 0; i<BOARD_SIZE; i++) /*For Castling - restoring the entire row*/
-		board[i][row] = lastMove[i];
-
-	return answer;
-}
-
-movesList_t* getKnightMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color) {
-
-	move_t* move = NULL;
-	movesList_t* answer = NULL, *tmpList = NULL;
-	pos_t pos;
-	int i, a, b, c, d;
-	int row, col;
-
-	answer = initEmptyList();
-	if (answer == NULL)
-		return NULL;
-
-	a = 1;
-	b = 2;
-	c = 2;
-	d = 4;
-	for (i = 0; i<2; i++){
-		for (row = startPos.row - b; row <= startPos.row + b; row += d) {
-			for (col = startPos.col - a; col <= startPos.col + a; col += c) {
-				pos.col = col; pos.row = row;
-				/*Condition: inBoard && (empty || opponent)*/
-				if (LEGAL){
-					if ((move = addPosToMove(move, pos)) == NULL) {
-						freeList(answer);
-						return NULL; /*allocation error*/
-					}
-					if ((tmpList = addMoveToMoves(answer, move)) == NULL) {
-						freeList(answer);
-						freeMove(move);
-						return NULL; /*allocation error*/
-					}
-					answer = tmpList;
-					move = NULL;
-				}
-			}
-		}
-		a = 2;
-		b = 1;
-		c = 4;
-		d = 2;
-	}
-
-	/*Push startPos to the beggining of all the moves in answer*/
-	if (!isEmpty(answer)) {
-		if ((tmpList = addPosToStart(answer, startPos)) == NULL) {
-			freeList(answer);
-			return NULL; /*allocation error*/
-		}
-	}
-
-	return answer;
-}
-
-/*Deletes all illegal moves from the list and returns answer->size*/
+/*Deletes all illegal moves from the list and returns answer->size
+ *king moves are checked against the attack map, other moves are played only if they may leave the king attacked*/
 int keepAllLegalMoves(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* answer, char color){
 
 	unsigned i, fromCol, fromRow, toCol, toRow, special;
 	movesList_t* nextMove, *keepNext;
 	char castling[BOARD_SIZE], undoFrom, undoTo;
+	attackMap_t* map;
+	unsigned long long attacked;
+	int king, check, illegal;
+	pos_t from, to;
 
 	/*safety check, nothing to change*/
 	if (answer == NULL || answer->size == 0)
 		return 0;
 
+	map = getAttackMap(board);
+	attacked = map->attacks[colorSide(invColor(color))];
+	king = map->king[colorSide(color)];
+	check = inCheck(map, color);
+
 	for (nextMove = answer; nextMove != NULL && nextMove->curr != NULL ; nextMove = keepNext){ /*for each move*/
 
 		keepNext = nextMove->next;
+		from = nextMove->curr->curr;
+		to = nextMove->curr->next->curr;
+
+		if (king != -1 && nextMove->curr->special != CASTLE) {
+			if (toSquare(from.col, from.row) == king) /*opposing sliders see through the king, it can't hide behind itself*/
+				illegal = (attacked & squareBit(toSquare(to.col, to.row))) != 0;
+			else if (!check && !onKingLine(king, from))
+				illegal = 0;
+			else
+				illegal = -1; /*play it to find out*/
+			if (illegal != -1) {
+				if (illegal) {
+					if (nextMove==answer && keepNext!=NULL) /*about to delete first move*/
+						keepNext = nextMove;
+					deleteMoveFromList(nextMove->curr, answer);
+				}
+				continue;
+			}
+		}
 
 		/*Keeping last move */
 		saveLastMove();
@@ -957,6 +386,11 @@ int keepAllLegalMoves(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* answer, c
 /*called to terminate program*/
 void quit(int ret){
 	startGame = 0;
+	ponderStop(); /*don't leave a search running in the background*/
+	traceClose(); /*write out records still in memory*/
+	logPoolStats(); /*after ponderStop, which adds in the ponder thread's counters*/
+	bookClose();
+	tbClose();
 	exit(ret);
 }
 
@@ -981,12 +415,32 @@ void setPiece(char board[BOARD_SIZE][BOARD_SIZE], pos_t pos, char piece) {
 
 }
 
+/*wall clock time in milliseconds, for search deadlines*/
+long getTimeMs() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long)tv.tv_sec*1000 + tv.tv_usec/1000;
+}
+
 /*returns pointer to first non-space char from s*/
 char* skipSpaces(char* s) {
 	for (; isspace(*s) && *s!='\0' ; s++);
 	return s;
 }
 
+/* letter of piece for output, ' ' for EMPTY */
+char pieceLetter(char piece) {
+	return pieceAttr(piece).letter;
+}
+
+/* piece of letter for input, EMPTY for anything that isn't a piece letter */
+char letterPiece(char letter) {
+	for (char piece=0 ; piece<PIECE_CODES ; piece++)
+		if (pieceInfo[(int)piece].index != -1 && pieceInfo[(int)piece].letter == letter)
+			return piece;
+	return EMPTY;
+}
+
 unsigned isValidMove(move_t* move) {
 	while (move != NULL) {
 		if (!isValidPos(move->curr))
@@ -1042,12 +496,18 @@ unsigned isSameMove(move_t* m1, move_t* m2) {
 pos_t getKingPos(char board[BOARD_SIZE][BOARD_SIZE], char player) {
 	pos_t p;
 	char myKing;
+	unsigned long long kings;
 	myKing = player==WHITE ? W_KING : B_KING;
-	for (p.col=0 ; p.col<BOARD_SIZE ; p.col++)
-		for (p.row=0 ; p.row<BOARD_SIZE ; p.row++)
-			if (board[p.col][p.row]==myKing)
-				return p;
-	return p; /*just to calm down the compiler*/
+	if (board == posState.board && posState.count[colorSide(player)] != 0) { /*king is first in the piece list*/
+		p.col = squareCol(posState.squares[colorSide(player)][0]);
+		p.row = squareRow(posState.squares[colorSide(player)][0]);
+		if (board[p.col][p.row] == myKing)
+			return p;
+	}
+	kings = scanPiece(board, myKing);
+	p.col = kings? squareCol(firstSquare(kings)):BOARD_SIZE; /*off board if there's no king*/
+	p.row = kings? squareRow(firstSquare(kings)):BOARD_SIZE;
+	return p;
 }
 
 /*Will fill unsigned answer[12] - [m,n,b,r,q,k,M,N,B,R,Q,K]*/
@@ -1168,37 +628,49 @@ void resetGlobals() {
 /******************* list utilities ************************/
 
 /*@pre: receive only dynamically allocated pointers*/
+/* list nodes come from listArena when one is in use (see arena.h), from pool.c otherwise */
+static void* allocNode(int kind) {
+	if (listArena != NULL)
+		return arenaAlloc(listArena, kind==POOL_MOVE? sizeof(move_t):sizeof(movesList_t));
+	return poolAlloc(kind);
+}
+
+static void freeNode(void* node, int kind) {
+	if (listArena == NULL && node != NULL)
+		poolFree(node, kind);
+}
+
 void freeMove(move_t* move) {
-	if (move == NULL)
+	if (move == NULL || listArena != NULL) /*arena nodes are freed by its owner*/
 		return;
 	freeMove(move->next);
-	free(move);
+	freeNode(move, POOL_MOVE);
 }
 
 void freeList(movesList_t* list){
 
-	if (list == NULL)
+	if (list == NULL || listArena != NULL) /*arena nodes are freed by its owner*/
 		return;
 	else
 		freeList(list->next);
 	freeMove(list->curr);
-	free(list);
+	freeNode(list, POOL_LIST);
 }
 
 /*free all moves in list (and list itself) except for exception move*/
 void freeListWithException(movesList_t* list, move_t* exception) {
-	if (list == NULL)
+	if (list == NULL || listArena != NULL) /*arena nodes are freed by its owner*/
 		return;
 	freeListWithException(list->next, exception);
 	if (list->curr != exception) /*compare by address*/
 		freeMove(list->curr);
-	free(list);
+	freeNode(list, POOL_LIST);
 }
 
 movesList_t* initEmptyList(){
 
 	movesList_t* list;
-	list = (movesList_t *)malloc(sizeof(movesList_t));
+	list = (movesList_t *)allocNode(POOL_LIST);
 	if (list == NULL){
 		return NULL; /*allocation error code*/
 	}
@@ -1229,7 +701,7 @@ movesList_t* addMoveToMoves(movesList_t *movesList, move_t* move) /* Adds move t
 		return movesList;
 	}
 
-	temp = (movesList_t *)malloc(sizeof(movesList_t));
+	temp = (movesList_t *)allocNode(POOL_LIST);
 	if (temp == NULL){
 		return NULL; /*allocation error code*/
 	}
@@ -1266,7 +738,7 @@ movesList_t* extendMovesList(movesList_t *answer, movesList_t *tmp_list){
 		answer->curr = tmp_list->curr;
 		answer->next = tmp_list->next;
 		answer->size = tmp_list->size;
-		free(tmp_list);
+		freeNode(tmp_list, POOL_LIST);
 		return answer;
 	}
 
@@ -1285,7 +757,7 @@ movesList_t* extendMovesList(movesList_t *answer, movesList_t *tmp_list){
 move_t* addPosToMove(move_t *move, pos_t pos)
 {
 	move_t *temp = NULL, *head = NULL;
-	temp = (move_t *)malloc(sizeof(move_t));
+	temp = (move_t *)allocNode(POOL_MOVE);
 	if (temp == NULL){
 		return NULL; /*allocation error code*/
 	}
@@ -1328,7 +800,7 @@ void deleteMoveFromList(move_t *move, movesList_t *list){
 			list->curr = NULL;
 		}
 		list->size--;
-		free(head);
+		freeNode(head, POOL_LIST);
 		freeMove(toDelete);
 		return;
 	}
@@ -1349,7 +821,7 @@ void deleteMoveFromList(move_t *move, movesList_t *list){
 	}
 	previous->next = current->next; /*bypass list node to be deleted*/
 	freeMove(move); /* equivalent to freeMove(current->curr)*/
-	free(current);
+	freeNode(current, POOL_LIST);
 
 }
 
@@ -1378,7 +850,7 @@ else: add pos to the end of current move*/
 move_t* addPosToStartOfMove(move_t* move, pos_t pos){
 
 	move_t *temp;
-	temp = (move_t *)malloc(sizeof(move_t));
+	temp = (move_t *)allocNode(POOL_MOVE);
 	if (temp == NULL){
 		return NULL; /*allocation error code*/
 	}
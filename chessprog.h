@@ -16,27 +16,42 @@
 #include <math.h>
 #include <assert.h>
 #include <time.h>
+#include <sys/time.h>
 
 #define DEBUG 0
 
+#define THREAD_LOCAL __thread /*globals that every search thread keeps its own copy of*/
+
 #define WHITE 'w'
 #define BLACK 's'
 #define invColor(C) ((C)==WHITE? BLACK:WHITE)
-#define getColor(P) (islower(P)? WHITE:BLACK)
-
-#define W_PAWN 'm'
-#define B_PAWN 'M'
-#define W_BISHOP 'b'
-#define B_BISHOP 'B'
-#define W_ROOK 'r'
-#define B_ROOK 'R'
-#define W_KNIGHT 'n'
-#define B_KNIGHT 'N'
-#define W_QUEEN 'q'
-#define B_QUEEN 'Q'
-#define W_KING 'k'
-#define B_KING 'K'
-#define EMPTY ' '
+#define getColor(P) (((P)&BLACK_PIECE)? BLACK:WHITE)
+
+/*a piece is its type with BLACK_PIECE set for black, attributes are looked up in pieceInfo.
+ *letters (m,n,b,r,q,k for white, upper case for black) are only used for input and output*/
+#define PAWN 1
+#define KNIGHT 2
+#define BISHOP 3
+#define ROOK 4
+#define QUEEN 5
+#define KING 6
+#define BLACK_PIECE 8
+#define PIECE_CODES 16 /*entries of pieceInfo*/
+#define pieceType(P) ((P)&(BLACK_PIECE-1))
+
+#define W_PAWN PAWN
+#define B_PAWN (BLACK_PIECE|PAWN)
+#define W_BISHOP BISHOP
+#define B_BISHOP (BLACK_PIECE|BISHOP)
+#define W_ROOK ROOK
+#define B_ROOK (BLACK_PIECE|ROOK)
+#define W_KNIGHT KNIGHT
+#define B_KNIGHT (BLACK_PIECE|KNIGHT)
+#define W_QUEEN QUEEN
+#define B_QUEEN (BLACK_PIECE|QUEEN)
+#define W_KING KING
+#define B_KING (BLACK_PIECE|KING)
+#define EMPTY 0
 #define CASTLE 'z' /*special mark for castling move*/
 #define NORM '\0' /*mark for non-special moves*/
 
@@ -46,9 +61,6 @@
 
 #define BOARD_SIZE 8
 #define inBoard(C,R) (0<=(C) && 0<=(R) && (C)<BOARD_SIZE && (R)<BOARD_SIZE)
-/*Condition: inBoard && pos != startPos && [empty || opponent]*/
-#define LEGAL 	inBoard(pos.col, pos.row) && (board[pos.col][pos.row]==EMPTY || \
-				color!=getColor(board[pos.col][pos.row]))
 
 typedef struct { /*index representation for location on board, range [0,BOARD_SIZE-1]*/
 	int col;
@@ -63,6 +75,15 @@ typedef struct move_t { /*first pos_t in move_t representds starting pos*/
 	char special;  /*to store markers for special moves (castling and promotions)*/
 } move_t;
 
+typedef struct { /*attributes of a piece, see pieceInfo*/
+	char letter; /*for print_board, saved games and the settings commands*/
+	signed char index; /*countPieces' order, -1 for EMPTY*/
+	int value; /*material weight of depth 1-4*/
+	int valueBest; /*material weight of BEST, x10 factor to avoid fp numbers*/
+	unsigned char firstStep, lastStep; /*slide directions in pieceSteps (see tables.h), none for non sliders*/
+	unsigned char sprite; /*column in the GUI's pieces sprite*/
+} pieceInfo_t;
+
 typedef struct movesList_t {
 	move_t* curr;
 	struct movesList_t* next;
@@ -76,7 +97,11 @@ extern unsigned minimaxDepth;
 extern char userColor;
 extern char gameMode;
 extern char nextPlayer;
-extern char wk, wlr, wrr, bk, blr, brr;
+extern char ponderMode;
+extern char statsLog;
+extern THREAD_LOCAL char wk, wlr, wrr, bk, blr, brr;
+extern const pieceInfo_t pieceInfo[PIECE_CODES]; /*indexed by piece*/
+#define pieceAttr(P) (pieceInfo[(unsigned char)(P)&(PIECE_CODES-1)])
 
 #define BEST 5 /*not actual depth, just higher than max (4) to act as code*/
 #define PVP 1
@@ -108,7 +133,10 @@ void updateCastlingFlags(char piece, pos_t pos);
 #define saveCastlingFlags() char wks=wk, wlrs=wlr, wrrs=wrr, bks=bk, blrs=blr, brrs=brr
 #define restoreCastlingFlags() wk=wks; wlr=wlrs; wrr=wrrs; bk=bks; blr=blrs; brr=brrs
 
-#define saveLastMove() 		fromCol = nextMove->curr->curr.col;		\
+/*posState (see position.h) is taken back with the board, so files using these must include position.h*/
+#define saveLastMove() 		posUndo_t undoPos;						\
+							savePosState(board, nextMove->curr, &undoPos); \
+							fromCol = nextMove->curr->curr.col;		\
 							fromRow = nextMove->curr->curr.row;		\
 							toCol = nextMove->curr->next->curr.col; \
 							toRow = nextMove->curr->next->curr.row; \
@@ -121,7 +149,8 @@ void updateCastlingFlags(char piece, pos_t pos);
 									castling[i] = board[i][fromRow];\
 							}
 
-#define restoreLastMove()	if (special != CASTLE){					\
+#define restoreLastMove()	restorePosState(&undoPos);				\
+							if (special != CASTLE){					\
 								board[fromCol][fromRow] = undoFrom;	\
 								board[toCol][toRow] = undoTo;		\
 							} else {								\
@@ -130,17 +159,8 @@ void updateCastlingFlags(char piece, pos_t pos);
 							}
 
 movesList_t* getAllLegalMoves(char board[BOARD_SIZE][BOARD_SIZE], char color);
-void deleteCastlingMoves(movesList_t *tmp_moves);
 int keepAllLegalMoves(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* answer, char color);
 movesList_t* getMovesForPiece(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos);
-movesList_t* getPawnMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color);
-movesList_t* getPawnPromotions(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color);
-movesList_t* getKingMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color);
-movesList_t* getCastlingMoves(char board[BOARD_SIZE][BOARD_SIZE], char color);
-movesList_t* getQueenMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos, char color);
-movesList_t* getBishopMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos,  char color);
-movesList_t* getRookMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos,  char color);
-movesList_t* getKnightMove(char board[BOARD_SIZE][BOARD_SIZE], pos_t startPos,  char color);
 
 int canMove(char board[BOARD_SIZE][BOARD_SIZE], char player);
 int canMovePiece(char board[BOARD_SIZE][BOARD_SIZE], pos_t pos);
@@ -149,6 +169,9 @@ int canMovePiece(char board[BOARD_SIZE][BOARD_SIZE], pos_t pos);
 void init_board(char board[BOARD_SIZE][BOARD_SIZE]);
 void resetGlobals();
 char* skipSpaces(char* s);
+char pieceLetter(char piece);
+char letterPiece(char letter);
+long getTimeMs();
 void copyBoard(char newBoard[BOARD_SIZE][BOARD_SIZE] ,char sourceBoard[BOARD_SIZE][BOARD_SIZE]);
 int inKingsRow(char board[BOARD_SIZE][BOARD_SIZE], pos_t pos);
 
@@ -166,12 +189,6 @@ void deleteMoveFromList(move_t *move, movesList_t *list);
 movesList_t* initEmptyList();
 int isEmpty(movesList_t* list);
 
-#define badAllocMoveList(M1,M2,L) 	 \
-			freeMove(M1); \
-			freeMove(M2); \
-			freeList(L); \
-			return NULL; \
-
 #define badAlloc3MovesList(M1,M2,M3,L) \
 		freeMove(M1); \
 		freeMove(M2); \
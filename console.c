@@ -9,6 +9,10 @@
 #include "console.h"
 #include "minimax.h"
 #include "files.h"
+#include "ponder.h"
+#include "book.h"
+
+static arena_t commandArena; /*list nodes of get_moves, get_best_moves and get_score, reset after each*/
 
 char* getInput(){
 	int len=0;
@@ -90,6 +94,65 @@ void parseSettings(char* s) {
 		if (DEBUG)
 			printf("depth: %u\n", minimaxDepth);
 	}
+	else if (strncmp(s, "ponder ", 7)==0 && gameMode==PVA) {
+		s = skipSpaces(s+7);
+		if (strcmp(s, "on")==0)
+			ponderMode = 1;
+		else if (strcmp(s, "off")==0)
+			ponderMode = 0;
+		else
+			print_message(ILLEGAL_COMMAND);
+		if (DEBUG)
+			printf("ponder: %d\n", (int)ponderMode);
+	}
+	else if (strncmp(s, "stats_log ", 10)==0) {
+		s = skipSpaces(s+10);
+		if (strcmp(s, "on")==0)
+			statsLog = 1;
+		else if (strcmp(s, "off")==0)
+			statsLog = 0;
+		else
+			print_message(ILLEGAL_COMMAND);
+	}
+	else if (strncmp(s, "pool ", 5)==0) { /*no list node is allocated in settings, so nodes never change hands*/
+		s = skipSpaces(s+5);
+		if (strcmp(s, "on")==0)
+			poolMode = 1;
+		else if (strcmp(s, "off")==0)
+			poolMode = 0;
+		else
+			print_message(ILLEGAL_COMMAND);
+	}
+	else if (strncmp(s, "nnue_file ", 10)==0) {
+		s = skipSpaces(s+10);
+		if (nnueLoad(s) == -1)
+			printf("Wrong file name\n");
+	}
+	else if (strncmp(s, "book_file ", 10)==0) {
+		s = skipSpaces(s+10);
+		if (strcmp(s, "off")==0)
+			bookClose();
+		else if (bookOpen(s) == -1)
+			printf("Wrong file name\n");
+	}
+	else if (strncmp(s, "nnue ", 5)==0 && gameMode==PVA) { /*nnue <1-4|best> on|off*/
+		s = skipSpaces(s+5);
+		tmp = strncmp(s, "best", 4)==0? BEST : ('1'<=*s && *s<='4')? *s-'0':0;
+		s = skipSpaces(s + (tmp==BEST? 4:1));
+		if (tmp!=0 && strcmp(s, "on")==0)
+			nnueLevels[tmp] = 1;
+		else if (tmp!=0 && strcmp(s, "off")==0)
+			nnueLevels[tmp] = 0;
+		else
+			print_message(ILLEGAL_COMMAND);
+	}
+	else if (strncmp(s, "trace ", 6)==0) {
+		s = skipSpaces(s+6);
+		if (strcmp(s, "off")==0)
+			traceClose();
+		else if (traceOpen(s) == -1)
+			printf("Wrong file name\n");
+	}
 	else if (strncmp(s, "user_color ", 11)==0 && gameMode==PVA) {
 		s = skipSpaces(s+11);
 		if (strcmp(s, "white")==0)
@@ -256,6 +319,7 @@ unsigned parseGame(char* s) { /*user's turn to play*/
 	pos_t p;
 	int tmp, boardState;
 	char* tmp_str;
+	arena_t* previous;
 
 	if (strncmp(s, "move ", 5)==0) {
 		if ((move=parseMoveFull(s)) != NULL) { /*if NULL: error was printed in function and startGame updated if needed*/
@@ -279,14 +343,15 @@ unsigned parseGame(char* s) { /*user's turn to play*/
 		else if (!isUserPos(gameBoard, p, userColor)) /*case 2*/
 			print_message(NO_DICS);
 		else { /*print moves from selected pos*/
+			previous = useArena(&commandArena);
 			moves = getMovesForPiece(gameBoard, p);
+			useArena(previous);
 			if (moves==NULL) {
 				startGame = 0; /*will exit game loop*/
 				print_malloc_error;
-			} else {
+			} else
 				printMovesList(moves);
-				freeList(moves);
-			}
+			arenaReset(&commandArena); /*instead of freeList*/
 		}
 	}
 	else if (strncmp(s, "get_best_moves ", 15)==0) {
@@ -295,14 +360,15 @@ unsigned parseGame(char* s) { /*user's turn to play*/
 			tmp = BEST;
 		else /*numeric argument in legal range*/
 			tmp = atoi(s);
-		moves = miniMax_lst(gameBoard, tmp, userColor, PLAYER_A, LIST_BEST);
+		previous = useArena(&commandArena);
+		moves = miniMax_lst(gameBoard, tmp, userColor, PLAYER_A, LIST_BEST, NULL);
+		useArena(previous);
 		if (moves == NULL) {
 			startGame = 0; /*will exit game loop*/
 			print_malloc_error;
-		} else {
+		} else
 			printMovesList(moves);
-			freeList(moves);
-		}
+		arenaReset(&commandArena); /*instead of freeList*/
 	}
 	else if (strncmp(s, "get_score ", 10)==0) {
 		s = skipSpaces(s+10);
@@ -318,7 +384,10 @@ unsigned parseGame(char* s) { /*user's turn to play*/
 			print_message(ILLEGAL_COMMAND);
 
 		if (move != NULL) { /*if NULL: error was printed earlier and startGame updated if needed*/
+			previous = useArena(&commandArena); /*move itself was allocated before, it's freed below*/
 			tmp = miniMax_move(move, gameBoard, tmp, userColor, PLAYER_A);
+			useArena(previous);
+			arenaReset(&commandArena);
 			if (tmp == MM_ERROR) {
 				startGame = 0;
 				print_malloc_error;
@@ -337,6 +406,12 @@ unsigned parseGame(char* s) { /*user's turn to play*/
 			analizeState(boardState); /*analize board state and determine proper prints and value for startGame*/
 		}
 	}
+	else if (strcmp(s, "stats")==0) {
+		printSearchStats(getSearchStats()); /*last search run by this thread*/
+	}
+	else if (strcmp(s, "pool_stats")==0) {
+		printPoolStats(getPoolStats());
+	}
 	else if (strncmp(s, "save ", 5)==0) {
 		s = skipSpaces(s+5);
 		if (saveGame(s)==-1) /*error code*/
@@ -419,27 +494,18 @@ move_t* parseMoveFull(char* s) {
 move_t* parseMove(char* s) {
 	move_t *move, *last;
 
-	move = (move_t*)malloc(sizeof(move_t));
+	move = addPosToMove(NULL, parsePos(s));
 	if (move==NULL)
 		return NULL; /*allocation error code, handle by caller*/
-	move->curr = parsePos(s);
-	move->size = 2;
-	move->next = NULL;
-	move->special = NORM;
 
-	last = (move_t*)malloc(sizeof(move_t));
-	if (last==NULL) {
-		freeMove(move);
-		return NULL; /*allocation error code, handle by caller*/
-	}
 	/*move up s to start of first pos after "to", we assume command in legal format*/
 	s = strstr(s, "to"); /*skip starting pos*/
 	s = strchr(s, '<'); /*point to start of second pos*/
-	last->curr = parsePos(s);
-	last->size = 1;
-	last->next = NULL;
-	last->special = NORM;
-	move->next = last; /*concat move*/
+	if (addPosToMove(move, parsePos(s)) == NULL) {
+		freeMove(move);
+		return NULL; /*allocation error code, handle by caller*/
+	}
+	last = move->next;
 
 	s = strchr(s, '>')+1; /*point to first char after second pos*/
 	s = skipSpaces(s); /*point to start of promotion piece, or '\0'*/
@@ -476,16 +542,21 @@ int isPromotionMove(char board[BOARD_SIZE][BOARD_SIZE], move_t* move) {
 /*return the state of the board after playing the computer's turn
  *return -1 as error code and print*/
 int computerPlay() {
-	move_t* move = miniMax_env(gameBoard, minimaxDepth, computerColor, PLAYER_A); /*extract best move for computer*/
+	move_t* move = ponderHit(gameBoard); /*use background search if user played the expected reply*/
 	int boardState;
+	if (move == NULL)
+		move = miniMax_env(gameBoard, minimaxDepth, computerColor, PLAYER_A, NULL); /*extract best move for computer*/
 	if (move == NULL) /*allocation error*/
 		return -1;
 	playMove(gameBoard, move);
+	logSearch(move);
 	printf("Computer: move ");
 	printMove(move);
-	freeMove(move);
 	print_board(gameBoard);
 	boardState = evalBoard(gameBoard, userColor);
+	if (ponderMode && (boardState==CONTINUE || boardState==CHECK))
+		ponderStart(gameBoard, move); /*think on the user's time*/
+	freeMove(move);
 
 	return boardState;
 }
@@ -515,6 +586,55 @@ int analizeState(int boardState) {
 	return boardState;
 }
 
+/* print counters of a search, one per line */
+void printSearchStats(searchStats_t stats) {
+	printf("nodes: %lu\n", stats.nodes);
+	printf("leaf evaluations: %lu\n", stats.leaves);
+	printf("move generations: %lu\n", stats.moveGens);
+	printf("transposition hits: %lu\n", stats.ttHits);
+	printf("tablebase hits: %lu\n", stats.tbHits);
+	printf("material draws: %lu\n", stats.drawCuts);
+	printf("beta cutoffs: %lu\n", stats.cutoffs);
+	printf("first move cutoffs: %.1f%%\n", stats.cutoffs? 100.0*stats.firstCutoffs/stats.cutoffs:0.0);
+	printf("lazy evaluations: %lu\n", stats.lazyExits);
+	printf("evaluation cache hits: %lu (%.1f%%)\n", stats.evalHits, stats.leaves? 100.0*stats.evalHits/stats.leaves:0.0);
+	printf("pawn cache hits: %lu (%.1f%%)\n", stats.pawnHits, stats.pawnProbes? 100.0*stats.pawnHits/stats.pawnProbes:0.0);
+	printf("plies: %u\n", stats.plies);
+	printf("effective branching factor: %.2f\n", stats.plies? pow((double)stats.nodes, 1.0/stats.plies):0.0);
+	printf("time: %ld ms\n", stats.time);
+	printf("nps: %.0f\n", stats.time? 1000.0*stats.nodes/stats.time:0.0);
+}
+
+/* if statsLog is on, write a single line with the counters of the search that picked move to stderr */
+void logSearch(move_t* move) {
+	searchStats_t stats = getSearchStats();
+	if (!statsLog)
+		return;
+	fprintf(stderr, "search: <%c,%d> to <%c,%d> plies %u nodes %lu leaves %lu movegens %lu tthits %lu tbhits %lu draws %lu " \
+			"cutoffs %lu first %.1f%% lazy %lu evalhits %lu pawnhits %lu/%lu ebf %.2f time %ldms nps %.0f\n",
+			'a'+move->curr.col, move->curr.row+1, 'a'+move->next->curr.col, move->next->curr.row+1,
+			stats.plies, stats.nodes, stats.leaves, stats.moveGens, stats.ttHits, stats.tbHits, stats.drawCuts, stats.cutoffs,
+			stats.cutoffs? 100.0*stats.firstCutoffs/stats.cutoffs:0.0, stats.lazyExits, stats.evalHits, stats.pawnHits, stats.pawnProbes,
+			stats.plies? pow((double)stats.nodes, 1.0/stats.plies):0.0,
+			stats.time, stats.time? 1000.0*stats.nodes/stats.time:0.0);
+}
+
+void printPoolStats(poolStats_t stats) {
+	printf("list node allocations: %llu\n", stats.allocs);
+	printf("list node frees: %llu\n", stats.frees);
+	printf("live list nodes: %lld (peak %lld)\n", stats.live, stats.peakLive);
+	printf("live list bytes: %lld (peak %lld)\n", stats.liveBytes, stats.peakBytes);
+	printf("pool slabs: %llu (%llu bytes)\n", stats.slabs, stats.slabBytes);
+}
+
+/* write a single line with the list node counters of the whole run to stderr, called at exit */
+void logPoolStats() {
+	poolStats_t stats = getPoolStats();
+	fprintf(stderr, "pool: %s allocs %llu frees %llu live %lld peak %lld bytes %lld peakbytes %lld slabs %llu\n",
+			poolMode? "on":"off", stats.allocs, stats.frees, stats.live, stats.peakLive, stats.liveBytes,
+			stats.peakBytes, stats.slabs);
+}
+
 /* return 1 on success. -1 on fail */
 int printAllLegalMoves(char board[BOARD_SIZE][BOARD_SIZE], char color){
 	movesList_t *movesList;
@@ -594,7 +714,7 @@ void print_board(char board[BOARD_SIZE][BOARD_SIZE])
 	{
 		printf("%d", j+1);
 		for (i = 0; i < BOARD_SIZE; i++){
-			printf("| %c ", board[i][j]);
+			printf("| %c ", pieceLetter(board[i][j]));
 		}
 		printf("|\n");
 		print_line();
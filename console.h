@@ -7,10 +7,13 @@
 /* contents: console mode "main" function and pasrsing    */
 /**********************************************************/
 #include "chessprog.h"
+#include "minimax.h"
+#include "pool.h"
 #ifndef CONSOLE_H_
 #define CONSOLE_H_
 
 #define MAX_INPUT 50
+#define STATS_LOG 0 /*default for statsLog, toggled by the "stats_log" setting*/
 char str_in[MAX_INPUT+1];
 
 #define ENTER_SETTINGS "Enter game settings:\n"
@@ -55,6 +58,10 @@ int isPromotionMove(char board[BOARD_SIZE][BOARD_SIZE], move_t* move);
 
 int computerPlay();
 int analizeState(int boardState);
+void printSearchStats(searchStats_t stats);
+void logSearch(move_t* move);
+void printPoolStats(poolStats_t stats);
+void logPoolStats();
 
 int printAllLegalMoves(char board[BOARD_SIZE][BOARD_SIZE], char color);
 void printMove(move_t* move);
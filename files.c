@@ -62,7 +62,7 @@ int saveGame(char* saveFile){
 				fclose(f);
 				return -1; }
 			for (j=0; j<BOARD_SIZE; j++){ /*columns*/
-				c = (gameBoard[j][i-1]==EMPTY) ? '_':gameBoard[j][i-1];
+				c = (gameBoard[j][i-1]==EMPTY) ? '_':pieceLetter(gameBoard[j][i-1]);
 				if(fputc(c,f)<0) {
 					fclose(f);
 					return -1; }
@@ -161,7 +161,7 @@ int loadGame(char* loadFile){
 					s[6]=='>' && strncmp(s+15, "</row_", 6)==0 && s[22]=='>') {
 				s+=7;
 				for (int col=0, row=s[14]-'1' ; col<BOARD_SIZE ; col++)
-					gameBoard[col][row] = s[col]=='_'? EMPTY:s[col];
+					gameBoard[col][row] = letterPiece(s[col]); /*'_' is EMPTY*/
 			}
 		} else if (strncmp(s, "</board>", 8)==0) {
 			board_c = 1;
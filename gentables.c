@@ -0,0 +1,86 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 gentables.c                                  */
+/* contents: writes the attack tables of tables.h         */
+/**********************************************************/
+#include "tables.h"
+
+/* usage: gentables > tables.c
+ * rays and kingAttacks step along pieceSteps of tables.h, so rays[d] matches rayStep(d) */
+
+static const int jumpSteps[8][2] = {{1,2}, {2,1}, {2,-1}, {1,-2}, {-1,-2}, {-2,-1}, {-2,1}, {-1,2}};
+
+typedef unsigned long long (*maskOf_t)(int square, int arg);
+
+/* squares reached from square by one of n steps, or by sliding along them to the edge if slide */
+static unsigned long long stepMask(int square, const int steps[][2], int n, int slide) {
+	unsigned long long mask = 0;
+	int c, r;
+
+	for (int d=0 ; d<n ; d++)
+		for (c=square/BOARD_SIZE+steps[d][0], r=square%BOARD_SIZE+steps[d][1] ; inBoard(c, r) ; \
+				c+=steps[d][0], r+=steps[d][1]) {
+			mask |= 1ULL << (c*BOARD_SIZE+r);
+			if (!slide)
+				break;
+		}
+	return mask;
+}
+
+static unsigned long long knightMask(int square, int unused) {
+	return stepMask(square, jumpSteps, 8, 0);
+}
+
+static unsigned long long kingMask(int square, int unused) {
+	return stepMask(square, pieceSteps, 8, 0);
+}
+
+/* side 0 is white, its pawns move to higher rows */
+static unsigned long long pawnMask(int square, int side) {
+	const int steps[2][2] = {{-1, side==0? 1:-1}, {1, side==0? 1:-1}};
+	return stepMask(square, steps, 2, 0);
+}
+
+static unsigned long long rayMask(int square, int d) {
+	return stepMask(square, pieceSteps+d, 1, 1);
+}
+
+/* print the initializer of the masks of all squares, nested in depth braces */
+static void printMasks(maskOf_t maskOf, int arg, int depth) {
+	printf("{");
+	for (int s=0 ; s<TABLE_SQUARES ; s++) {
+		if (s%4 == 0)
+			printf("\n%s", depth? "\t\t":"\t");
+		printf("0x%016llxULL%s", maskOf(s, arg), s==TABLE_SQUARES-1? "":s%4==3? ",":", ");
+	}
+	printf("\n%s}", depth? "\t":"");
+}
+
+/* print the definition of table name, n initializers by maskOf(square, i) for i<n, a single one if n==0 */
+static void printTable(const char* name, maskOf_t maskOf, int n) {
+	if (n == 0) {
+		printf("const unsigned long long %s[TABLE_SQUARES] = ", name);
+		printMasks(maskOf, 0, 0);
+	}
+	else {
+		printf("const unsigned long long %s[%d][TABLE_SQUARES] = {\n\t", name, n);
+		for (int i=0 ; i<n ; i++) {
+			printMasks(maskOf, i, 1);
+			printf(i<n-1? ", ":"\n}");
+		}
+	}
+	printf(";\n\n");
+}
+
+int main() {
+	printf("/* tables.c: generated by gentables, don't edit (see tables.h) */\n");
+	printf("#include \"tables.h\"\n\n");
+	printTable("knightAttacks", knightMask, 0);
+	printTable("kingAttacks", kingMask, 0);
+	printTable("pawnAttacks", pawnMask, 2);
+	printTable("rays", rayMask, 8);
+	return ferror(stdout)? 1:0;
+}
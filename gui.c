@@ -17,6 +17,7 @@ SDL_Surface *pieces = NULL;
 SDL_Surface *pieces_frame = NULL;
 SDL_Surface *buttons = NULL;
 control_t *mainMenu, *loadMenu, *saveMenu, *selectionMenu, *AIMenu, *gameWindow, *pieceSelection, *difficultyMenu, *promotionsMenu;
+static arena_t selectionArena; /*list nodes of the moves highlighted for the selected piece*/
 
 /* main control function
  * return 0 on succesful execution, 1 for error*/
@@ -935,11 +936,13 @@ int computerPlay_GUI(control_t* root, int state) {
 	if (blitControl(root, initRect(0,0,0,0))==GUI_ERROR || display()==GUI_ERROR)
 		return GUI_ERROR;
 
-	move = miniMax_env(gameBoard, minimaxDepth, computerColor, PLAYER_A); /*extract best move for computer*/
+	if ((move = ponderHit(gameBoard)) == NULL) /*use background search if user played the expected reply*/
+		move = miniMax_env(gameBoard, minimaxDepth, computerColor, PLAYER_A, NULL); /*extract best move for computer*/
 	if (move == NULL) { /*allocation error*/
 		print_malloc_error;
 		return GUI_ERROR;
 	}
+	logSearch(move);
 
 	/*"stupid delay" - make computer wait at least 1 second before playing*/
 	end = time(NULL);
@@ -956,6 +959,8 @@ int computerPlay_GUI(control_t* root, int state) {
 		printf("Computer: move ");
 		printMove(move);
 	}
+	if (ponderMode) /*no reply is known if the game just ended, so this won't start*/
+		ponderStart(gameBoard, move); /*think on the user's time*/
 	freeMove(move);
 	return CONTINUE;
 }
@@ -975,6 +980,7 @@ int playerTurn(control_t* root, int boardEvent, int panelEvent){
 	pos_t from, to;
 	move_t *move=NULL;
 	movesList_t *moves=NULL;
+	arena_t* previous;
 	int depth=minimaxDepth, moveFlag=0, retVal;
 	static int showMoves = 0;
 
@@ -1019,7 +1025,7 @@ int playerTurn(control_t* root, int boardEvent, int panelEvent){
 			} else if (startGame && inControl(button_hint, &e)) {
 				if (moveFlag) { /*some piece is already selected*/
 					moveFlag = 0;
-					freeList(moves);
+					arenaReset(&selectionArena); /*instead of freeList*/
 					moves = NULL;
 				}
 				if (gameMode==PVP) {
@@ -1034,7 +1040,7 @@ int playerTurn(control_t* root, int boardEvent, int panelEvent){
 					retVal = GUI_ERROR;
 					break;
 				}
-				if ((move = miniMax_env(gameBoard, depth, nextPlayer, PLAYER_A)) == NULL) {
+				if ((move = miniMax_env(gameBoard, depth, nextPlayer, PLAYER_A, NULL)) == NULL) {
 					print_malloc_error;
 					retVal = GUI_ERROR;
 					break;
@@ -1066,7 +1072,11 @@ int playerTurn(control_t* root, int boardEvent, int panelEvent){
 					from = click2pos(e);
 					if (from.row!=8 && from.col!=-1) {/* click is not out of the board */
 						if (isUserPos(gameBoard, from, nextPlayer)) { /*this means we clicked on a piece of our color*/
-							if ((moves=getMovesForPiece(gameBoard, from)) == NULL) {
+							arenaReset(&selectionArena); /*a selection left by an earlier call isn't freed*/
+							previous = useArena(&selectionArena);
+							moves = getMovesForPiece(gameBoard, from);
+							useArena(previous);
+							if (moves == NULL) {
 								print_malloc_error;
 								return GUI_ERROR;
 							}
@@ -1080,7 +1090,7 @@ int playerTurn(control_t* root, int boardEvent, int panelEvent){
 						if (to.col==from.col && to.row==from.row) { /*if same pos was clicked - clean and continue*/
 							boardEvent = 1;
 							moveFlag = 0;
-							freeList(moves);
+							arenaReset(&selectionArena); /*instead of freeList*/
 							moves = NULL;
 							continue;
 						}
@@ -1131,7 +1141,7 @@ int playerTurn(control_t* root, int boardEvent, int panelEvent){
 		}
 	}
 
-	freeList(moves);
+	arenaReset(&selectionArena); /*instead of freeList(moves)*/
 	return retVal;
 
 }
@@ -1302,36 +1312,11 @@ int setPiece_GUI(pos_t pos, char piece, char frame){
 	clip.w = TILE_HIGHT;
 	clip.y = (getColor(piece)==BLACK) ? NEXT_PIECE : 0; /*Clip 1st row for WHITE or 2nd for BLACK*/
 
-	switch (piece) {
-	case EMPTY:
+	if (piece == EMPTY) {
 		source = back;
 		clip = offset;
-		break;
-	case W_PAWN:
-	case B_PAWN:
-		clip.x = NEXT_PIECE*0;
-		break;
-	case W_KNIGHT:
-	case B_KNIGHT:
-		clip.x = NEXT_PIECE*1;
-		break;
-	case W_BISHOP:
-	case B_BISHOP:
-		clip.x = NEXT_PIECE*2;
-		break;
-	case W_QUEEN:
-	case B_QUEEN:
-		clip.x = NEXT_PIECE*3;
-		break;
-	case W_ROOK:
-	case B_ROOK:
-		clip.x = NEXT_PIECE*4;
-		break;
-	case W_KING:
-	case B_KING:
-		clip.x = NEXT_PIECE*5;
-		break;
-	}
+	} else
+		clip.x = NEXT_PIECE*pieceAttr(piece).sprite;
 
 	if (rm_GUI(pos,'n')<0 || applySurface(&offset,source,screen,&clip)<0)
 		return GUI_ERROR;
@@ -12,6 +12,7 @@
 #include "console.h"
 #include "files.h"
 #include "minimax.h"
+#include "ponder.h"
 
 #ifndef GUI_H_
 #define GUI_H_
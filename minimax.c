@@ -8,68 +8,109 @@
 /**********************************************************/
 #include "minimax.h"
 #include "console.h"
+#include "book.h"
+#include "tablebase.h"
+
+static THREAD_LOCAL searchLimits_t* mmLimits = NULL; /*limits of the current search, NULL for none*/
+THREAD_LOCAL searchStats_t mmStats; /*counters of the running search*/
+static THREAD_LOCAL searchStats_t lastStats; /*counters of the last finished search*/
+static THREAD_LOCAL int mmAborted = 0; /*set once a limit was reached, search then unwinds*/
+static THREAD_LOCAL pvTable_t pvTable = {NULL, 0}; /*expected replies for root moves of last miniMax_lst*/
+static THREAD_LOCAL evalEntry_t evalCache[EVAL_CACHE_SIZE]; /*kept across searches*/
+static THREAD_LOCAL pawnEntry_t pawnCache[PAWN_CACHE_SIZE]; /*kept across searches*/
+static THREAD_LOCAL ttEntry_t ttTable[TT_SIZE]; /*hash moves of the current search*/
+static THREAD_LOCAL unsigned ttAge = 0; /*count of searches started by this thread, see ttEntry_t*/
+static THREAD_LOCAL pvReply_t pvLast; /*best reply found by the last realDepth 1 node, root==NULL if none*/
+
+/* reset per search state, limits may be NULL for an unlimited search */
+void initSearch(searchLimits_t* limits) {
+	mmLimits = limits;
+	mmAborted = 0;
+	ttAge++; /*hash moves aren't kept from search to search, so a search's work depends only on its position*/
+	memset(&mmStats, 0, sizeof(mmStats));
+	mmStats.time = getTimeMs();
+}
+
+/* stop the clock of the current search and keep its counters */
+void finishSearch() {
+	mmStats.time = getTimeMs()-mmStats.time;
+	lastStats = mmStats;
+	trackBoard(NULL); /*board may be a local copy*/
+	traceFlush();
+}
+
+/* counters of the last search in this thread */
+searchStats_t getSearchStats() {
+	return lastStats;
+}
+
+/* replace this thread's counters with those of a search run by another thread */
+void setSearchStats(searchStats_t stats) {
+	lastStats = stats;
+}
+
+/* count a visited board and check the search limits
+ * @post: return 1 iff the search should stop (then it stays stopped until initSearch)*/
+int searchAborted() {
+	mmStats.nodes++;
+	if (mmAborted || mmLimits==NULL)
+		return mmAborted;
+	if (mmLimits->maxNodes!=0 && mmStats.nodes>mmLimits->maxNodes)
+		mmAborted = 1;
+	else if ((mmStats.nodes & (LIMITS_CHECK-1)) == 0) { /*don't look at the clock every node*/
+		if ((mmLimits->stop!=NULL && *mmLimits->stop) || \
+				(mmLimits->deadline!=0 && getTimeMs()>=mmLimits->deadline))
+			mmAborted = 1;
+	}
+	return mmAborted;
+}
 
 /* same as regular minimax, but returns list of best scoring moves, not just one
  * @pre: depth>0
- * @post: returns NULL for allocation error or illegal depth*/
-movesList_t* miniMax_lst(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer, char returnList) {
+ * @post: returns NULL for allocation error or illegal depth
+ * @post: if a limit is reached, returns the best moves among those fully searched so far
+ *        (or all moves if none was)*/
+movesList_t* miniMax_lst(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer, \
+		char returnList, searchLimits_t* limits) {
 	/* playerA = computerColor (who we run the algorithm for) -> white/black (maximizing player)
 	 * currentPlayer = A/B (are we in min or max level? A=max, B=min)
 	 */
 	movesList_t* moves = NULL;
 	movesList_t* nextMove=NULL;
 	int bestScore = currentPlayer==PLAYER_A? MIN_INF:MAX_INF; /*init to worst possible score for current player*/
-	int tmp, maxBoards=MM_LIMIT;
-	int alpha=MIN_INF, beta=MAX_INF;
-	int fromRow, fromCol, toRow, toCol;
-	char special, undoTo, undoFrom;
-	char castling[8];
-	int i;
 
+	if (depth==0)
+		return NULL; /*error code*/
+	initSearch(limits);
+	trackBoard(board);
+	if (useNnue(depth))
+		trackNnue();
+	if (limits!=NULL && limits->maxDepth!=0 && depth!=BEST && depth>limits->maxDepth)
+		depth = limits->maxDepth;
 	moves = getAllLegalMoves(board, currentPlayer==PLAYER_A? playerA:invColor(playerA));
-	if (moves==NULL)
+	if (moves==NULL) {
+		finishSearch();
 		return NULL;
+	}
 	for (nextMove=moves ; !isEmpty(nextMove) ; nextMove=nextMove->next)
 		nextMove->curr->score = bestScore; /*init all scores to worse possible*/
 	nextMove=NULL;
-
-	if (depth==BEST) /*makes sure we only use this limit for best option*/
-		maxBoards /= isEmpty(moves)? 1:moves->size;
-	if (depth==0) {
-		return NULL; /*error code*/
-	} else if (isEmpty(moves)) {
-		bestScore = scoringFunction(board, playerA, currentPlayer, depth, 0);
-		if (bestScore == MM_ERROR) { /*allocation error code*/
-			freeList(moves);
-			return NULL;
-		}
+	free(pvTable.replies); /*replies are optional, so allocation failure just disables them*/
+	pvTable.replies = (pvReply_t*)malloc((isEmpty(moves)? 1:moves->size)*sizeof(pvReply_t));
+	pvTable.size = 0;
+
+	if (isEmpty(moves)) {
+		bestScore = scoringFunction(board, playerA, currentPlayer, depth, 0, MIN_INF, MAX_INF);
+	} else if (depth==BEST) {
+		bestScore = searchBest(board, moves, playerA, currentPlayer, limits);
 	} else {
-		for (nextMove=moves ; nextMove != NULL ; nextMove=nextMove->next) {
-			saveCastlingFlags();
-			saveLastMove();
-			playMove(board, nextMove->curr);
-			tmp = miniMax_rec(board, depth==BEST? depth:depth-1, \
-					playerA, currentPlayer==PLAYER_A? PLAYER_B:PLAYER_A, alpha, beta, maxBoards, 1);
-			restoreCastlingFlags();
-			restoreLastMove();
-			if (tmp == MM_ERROR) {
-				freeList(moves); /*free all resources before returning error code*/
-				return NULL;
-			}
-			nextMove->curr->score = tmp; /*update score for current move*/
-
-			if (DEBUG_MM) {
-				printf("depth 0: playing ");
-				printMove(nextMove->curr);
-			}
-			
-			if (currentPlayer==PLAYER_A && tmp>bestScore) { /*maximize score*/
-				bestScore = tmp;
-			} else if (currentPlayer==PLAYER_B && tmp<bestScore) { /*minimize score*/
-				bestScore = tmp;
-			}
-			/*we can't use pruning in first level if we want all moves to get real scores*/
-		}
+		bestScore = searchRoot(board, moves, depth, playerA, currentPlayer);
+		mmStats.plies = mmAborted? 0:depth;
+	}
+	if (bestScore == MM_ERROR) { /*allocation error code*/
+		freeList(moves);
+		finishSearch();
+		return NULL;
 	}
 
 	if (DEBUG_MM_SCORE) {
@@ -86,9 +127,113 @@ movesList_t* miniMax_lst(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, cha
 	} else if (returnList==LIST_ALL && DEBUG_MM_SCORE)
 		printf("keeping all moves!\n");
 
+	finishSearch();
 	return moves;
 }
 
+/* score all root moves (first level of miniMax_lst) with a single search of depth
+ * @pre: !isEmpty(moves)
+ * @post: return best score among moves searched before a limit was reached, MM_ERROR for allocation error*/
+int searchRoot(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* moves, unsigned depth, char playerA, char currentPlayer) {
+	movesList_t* nextMove=NULL;
+	int bestScore = currentPlayer==PLAYER_A? MIN_INF:MAX_INF; /*init to worst possible score for current player*/
+	int tmp;
+	int alpha=MIN_INF, beta=MAX_INF;
+	int fromRow, fromCol, toRow, toCol;
+	char special, undoTo, undoFrom;
+	char castling[8];
+	int i;
+
+	for (nextMove=moves ; nextMove != NULL ; nextMove=nextMove->next) {
+		saveCastlingFlags();
+		saveLastMove();
+		playMove(board, nextMove->curr);
+		pvLast.root = NULL;
+		tmp = miniMax_rec(board, depth==BEST? depth:depth-1, \
+				playerA, currentPlayer==PLAYER_A? PLAYER_B:PLAYER_A, alpha, beta, 1);
+		restoreCastlingFlags();
+		restoreLastMove();
+		if (tmp == MM_ERROR)
+			return MM_ERROR;
+		if (tmp == MM_ABORT) /*limit reached, this move's score is incomplete*/
+			break;
+		nextMove->curr->score = tmp; /*update score for current move*/
+		if (pvLast.root != NULL) { /*remember expected reply for pondering*/
+			pvLast.root = nextMove->curr;
+			recordRootReply();
+		}
+
+		if (currentPlayer==PLAYER_A && tmp>bestScore) { /*maximize score*/
+			bestScore = tmp;
+		} else if (currentPlayer==PLAYER_B && tmp<bestScore) { /*minimize score*/
+			bestScore = tmp;
+		}
+		/*we can't use pruning in first level if we want all moves to get real scores*/
+	}
+	return bestScore;
+}
+
+/* minimax best: search BEST_MIN_DEPTH plies, then one more ply at a time until MM_LIMIT boards were
+ * visited in total (or the next search isn't expected to fit). Scores are those of the deepest search
+ * that was completed, so the same position always costs the same work and gets the same result.
+ * @pre: !isEmpty(moves)
+ * @post: return best score, MM_ERROR for allocation error*/
+int searchBest(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* moves, char playerA, char currentPlayer, \
+		searchLimits_t* limits) {
+	searchLimits_t iteration = {0, 0, 0, NULL};
+	movesList_t* nextMove;
+	int *scores, bestScore = MM_ERROR, tmp;
+	unsigned long nodes, lastNodes = 0, budget = MM_LIMIT;
+	unsigned i;
+
+	if ((scores = (int*)malloc(moves->size*sizeof(int))) == NULL)
+		return MM_ERROR;
+	if (limits != NULL)
+		iteration = *limits;
+	if (limits != NULL && limits->maxNodes != 0 && limits->maxNodes < budget)
+		budget = limits->maxNodes;
+
+	for (unsigned d=BEST_MIN_DEPTH ; ; d++) {
+		iteration.maxDepth = d;
+		if (d > BEST_MIN_DEPTH) /*first search is always completed, unless the caller limited it*/
+			iteration.maxNodes = budget;
+		mmLimits = &iteration;
+		for (nextMove=moves, i=0 ; nextMove!=NULL ; nextMove=nextMove->next) /*keep last completed scores*/
+			scores[i++] = nextMove->curr->score;
+
+		nodes = mmStats.nodes;
+		tmp = searchRoot(board, moves, BEST, playerA, currentPlayer);
+		if (tmp == MM_ERROR) {
+			bestScore = MM_ERROR;
+			break;
+		}
+		if (mmAborted) {
+			if (d == BEST_MIN_DEPTH) { /*nothing better to fall back to*/
+				bestScore = tmp;
+				break;
+			}
+			for (nextMove=moves, i=0 ; nextMove!=NULL ; nextMove=nextMove->next) /*restore last completed*/
+				nextMove->curr->score = scores[i++];
+			break;
+		}
+		bestScore = tmp;
+		mmStats.plies = d;
+		nodes = mmStats.nodes-nodes;
+		if (nodes == lastNodes) /*deeper search visited the same boards, all lines already ended*/
+			break;
+		if (limits != NULL && limits->maxDepth != 0 && d >= limits->maxDepth)
+			break;
+		/*don't start a search that is expected to run out of boards, using growth of the last one*/
+		if (lastNodes != 0 && mmStats.nodes + nodes*((nodes+lastNodes-1)/lastNodes) > budget)
+			break;
+		lastNodes = nodes;
+	}
+
+	mmLimits = limits;
+	free(scores);
+	return bestScore;
+}
+
 movesList_t* keepBestMoves(movesList_t* answer, int bestScore){
 
 	movesList_t *bestMovesList = answer, *keepNext;
@@ -119,17 +264,25 @@ movesList_t* keepBestMoves(movesList_t* answer, int bestScore){
 int miniMax_move(move_t* move, char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer) {
 	int bestScore = currentPlayer==PLAYER_A? MIN_INF:MAX_INF; /*init to worst possible score for current player*/
 	movesList_t* moves;
-	int alpha=MIN_INF, beta=MAX_INF, maxBoards=MM_LIMIT;
+	int alpha=MIN_INF, beta=MAX_INF;
 	char newBoard[BOARD_SIZE][BOARD_SIZE];
 	saveCastlingFlags();
 
-	/* duplicate depth for actual minimax best */
-	if ((moves=getAllLegalMoves(board, currentPlayer==PLAYER_A? playerA:invColor(playerA))) == NULL)
-		return MM_ERROR;
-	maxBoards /= moves->size; /*move is in moves and so !isEmpty(moves)*/
-	freeList(moves);
+	if (depth==BEST) { /*search depth of best depends on all root moves, so run the actual minimax*/
+		if ((moves = miniMax_lst(board, depth, playerA, currentPlayer, LIST_ALL, NULL)) == NULL)
+			return MM_ERROR;
+		for (movesList_t* nextMove=moves ; !isEmpty(nextMove) ; nextMove=nextMove->next)
+			if (isSameMove(move, nextMove->curr))
+				bestScore = nextMove->curr->score;
+		freeList(moves);
+		return bestScore;
+	}
 
+	initSearch(NULL);
 	copyBoard(newBoard, board);
+	trackBoard(newBoard);
+	if (useNnue(depth))
+		trackNnue();
 	if (DEBUG_MM_SCORE) {
 		for (unsigned i=depth ; i<4 ; i++)
 			putchar('\t');
@@ -137,21 +290,37 @@ int miniMax_move(move_t* move, char board[BOARD_SIZE][BOARD_SIZE], unsigned dept
 		printMove(move);
 	}
 	playMove(newBoard, move);
-	bestScore = miniMax_rec(newBoard, depth==BEST? depth:depth-1, \
-		playerA, currentPlayer==PLAYER_A? PLAYER_B:PLAYER_A, alpha, beta, maxBoards, 1);
+	bestScore = miniMax_rec(newBoard, depth-1, \
+		playerA, currentPlayer==PLAYER_A? PLAYER_B:PLAYER_A, alpha, beta, 1);
 
+	finishSearch();
 	restoreCastlingFlags();
 	return bestScore;
 }
 
-/* @post: return MM_ERROR in case of bad alloc
+/* score of a tablebase value of the board at realDepth with currentPlayer to move, DRAW_SCORE for a draw
+ * and a mate below WIN_A*factor (so a mate seen on the board is preferred), sooner mates scoring higher
+ */
+static int tbScore(int value, char currentPlayer, int factor, int realDepth) {
+	int maximize = currentPlayer==PLAYER_A? 1:-1, plies, score;
+
+	if (value == TB_DRAW) /*not a tie's score, that would make the side moving into it avoid a draw it can't better*/
+		return DRAW_SCORE;
+	plies = realDepth+tbPlies(value);
+	plies = plies<1? 1 : plies>98? 98:plies; /*keeps clear of TIE_A/TIE_B and above NNUE_LIMIT*/
+	score = factor*(WIN_A-1)-plies;
+	return tbWins(value)? score*maximize : -score*maximize;
+}
+
+/* moves are tried in the order of a move picker (see movepick.h), starting with the hash move of the board
+ * @post: return MM_ERROR in case of bad alloc
  */
 int miniMax_rec(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, \
-		char playerA, char currentPlayer, int alpha, int beta, int maxBoards, int realDepth) {
+		char playerA, char currentPlayer, int alpha, int beta, int realDepth) {
 	/* playerA = computerColor (who we run the algorithm for) -> white/black (maximizing player)
 	 * currentPlayer = A/B (are we in min or max level? A=max, B=min)
 	 */
-	movesList_t* moves = NULL;
+	movePicker_t picker;
 	movesList_t* nextMove=NULL;
 	int best_factor = depth==BEST? 10:1;
 	int bestScore = currentPlayer==PLAYER_A? MIN_INF:MAX_INF; /*init to worst possible score for current player*/
@@ -160,82 +329,128 @@ int miniMax_rec(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, \
 	char special, undoTo, undoFrom;
 	char castling[8];
 	int i;
-
-	if (depth!=0 && (maxBoards>1 || realDepth<4)) { /*not terminal node - prevent wasted moves generation*/
-		moves = getAllLegalMoves(board, currentPlayer==PLAYER_A? playerA:invColor(playerA));
-		if (moves==NULL) {
-			return MM_ERROR; /*allocation error code*/
+	char color = currentPlayer==PLAYER_A? playerA:invColor(playerA);
+	unsigned searched = 0; /*moves searched before a cutoff, for the trace*/
+	move_t* bestMove = NULL;
+	arenaMark_t mark = {NULL, 0};
+	ttEntry_t* entry = NULL;
+	hashMove_t hash = {0, 0, NORM};
+	unsigned long long key;
+	int tb;
+
+	if (listArena != NULL) /*lists of this board and below are released at once on return*/
+		mark = arenaMark(listArena);
+	if (searchAborted())
+		return MM_ABORT;
+	if (board==posState.board && posState.count[0]+posState.count[1]<=TB_MAX_PIECES && (tb = tbProbe(board, color))!=TB_NONE) {
+		mmStats.tbHits++; /*exact score, nothing to search*/
+		return tbScore(tb, currentPlayer, best_factor, realDepth);
+	}
+	if (depth==BEST && board==posState.board && isDrawnMaterial(&posState)) { /*depths 1-4 keep material scoring*/
+		mmStats.drawCuts++; /*neither side can force a win from here*/
+		return DRAW_SCORE;
+	}
+	TRACE(TRACE_ENTER, realDepth, NULL, 0, 0, alpha, beta, 0);
+	if (board == posState.board) { /*the table is keyed by the tracked position*/
+		key = positionKey(&posState, color);
+		entry = &ttTable[key & (TT_SIZE-1)];
+		if (entry->key==key && entry->age==ttAge) {
+			hash = entry->move;
+			mmStats.ttHits++;
 		}
-		for (nextMove=moves ; !isEmpty(nextMove) ; nextMove=nextMove->next)
-			nextMove->curr->score = bestScore; /*initall scores to worse possible*/
-		nextMove=NULL;
 	}
+	initPicker(&picker, board, color, hash);
 
-	if (depth==BEST && !isEmpty(moves) && maxBoards>=moves->size) /*makes sure we only use this limit for best option*/
-		maxBoards /= moves->size;
-	if (depth==0 || isEmpty(moves) || (maxBoards<=1 && realDepth>=4)) {
-		bestScore = scoringFunction(board, playerA, currentPlayer, depth, realDepth);
-		if (bestScore == MM_ERROR) { /*allocation error code*/
-			freeList(moves);
-			return MM_ERROR;
-		}
-	} else { /*for maxBoards<moves->size use cntr to itterate on exactly maxBoards number of moves*/
-		for (nextMove=moves ; nextMove!=NULL ; nextMove=nextMove->next) {
+	/*BEST never runs out of depth, it is always limited by maxDepth (see searchBest)*/
+	if (depth!=0 && (mmLimits==NULL || mmLimits->maxDepth==0 || realDepth<mmLimits->maxDepth)) { /*not terminal node - prevent wasted moves generation*/
+		while ((nextMove = nextPickedMove(&picker)) != NULL) {
 			saveCastlingFlags();
 			saveLastMove();
 			playMove(board, nextMove->curr);
 			tmp = miniMax_rec(board, depth==BEST? depth:depth-1, playerA, \
-					currentPlayer==PLAYER_A? PLAYER_B:PLAYER_A, alpha, beta, \
-							maxBoards<moves->size? 0:maxBoards, realDepth+1); /*force next level to evalute the board if maxed out*/
+					currentPlayer==PLAYER_A? PLAYER_B:PLAYER_A, alpha, beta, realDepth+1);
 			restoreCastlingFlags();
 			restoreLastMove();
-			if (tmp == MM_ERROR) {
+			if (tmp == MM_ERROR || tmp == MM_ABORT) {
 				bestScore = tmp; /*causes error code to go to the main caller*/
 				break;
 			}
 			nextMove->curr->score = tmp; /*update score for current move*/
-
-			if (DEBUG_MM) {
-				for (int i=realDepth ; i>0 ; i--)
-					printf("\t");
-				printf("depth %d: playing ", realDepth);
-				printMove(nextMove->curr);
-			}
+			searched++;
 
 			if (currentPlayer==PLAYER_A && tmp>bestScore) { /*maximize score*/
 				bestScore = tmp;
+				bestMove = nextMove->curr;
 				alpha = alpha>bestScore? alpha:bestScore; /*maximize alpha*/
+				if (realDepth==1)
+					recordReply(nextMove->curr);
 			} else if (currentPlayer==PLAYER_B && tmp<bestScore) { /*minimize score*/
 				bestScore = tmp;
+				bestMove = nextMove->curr;
 				beta = beta<bestScore? beta:bestScore; /*minimize beta*/
+				if (realDepth==1)
+					recordReply(nextMove->curr);
 			}
 			if (beta<=alpha) {
-				if (DEBUG_MM) {
-					for (int i=realDepth ; i>0 ; i--)
-						putchar('\t');
-					printf("depth %d: pruned!\n", realDepth);
-				}
+				mmStats.cutoffs++;
+				if (searched == 1) /*first move tried*/
+					mmStats.firstCutoffs++;
+				TRACE(TRACE_CUTOFF, realDepth, nextMove->curr, searched-1, picker.generated, alpha, beta, bestScore);
 				break;
 			}
 		}
+		if (picker.stage == PICK_ERROR)
+			bestScore = MM_ERROR; /*allocation error code, unwinds through the common exit below*/
+	}
+
+	if (bestScore == MM_ERROR) {} /*don't score or store a board whose moves weren't all generated*/
+	else if (picker.size == 0) /*terminal node, or no legal moves*/
+		bestScore = scoringFunction(board, playerA, currentPlayer, depth, realDepth, alpha, beta);
+	else if (entry != NULL && bestMove != NULL && bestScore != MM_ABORT) {
+		entry->key = key;
+		entry->age = ttAge;
+		entry->move = toHashMove(bestMove);
 	}
 
 	/*adjust score for tie - needs to be second worse option for the opposite of currentPlayer*/
-	if ( (bestScore==TIE_A*best_factor && currentPlayer==PLAYER_A) || (bestScore==TIE_B*best_factor && currentPlayer==PLAYER_B) )
+	if (bestScore==MM_ABORT || bestScore==MM_ERROR) {} /*do nothing, just unwind*/
+	else if ( (bestScore==TIE_A*best_factor && currentPlayer==PLAYER_A) || (bestScore==TIE_B*best_factor && currentPlayer==PLAYER_B) )
 		bestScore *= -1;
 
-	freeList(moves); /*free all moves in list*/
+	TRACE(TRACE_EXIT, realDepth, bestMove, searched, picker.generated, alpha, beta, bestScore);
+	if (listArena != NULL)
+		arenaRelease(listArena, mark);
+	else
+		freePicker(&picker); /*free all moves generated*/
 	return bestScore;
 }
 
+/* the move to play for playerA, from the opening book if board is in it, searched otherwise */
+move_t* miniMax_env(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer, \
+		searchLimits_t* limits) {
+	move_t* move;
+	searchStats_t noStats;
+	pvTable_t noReplies = {NULL, 0};
+
+	if ((move = bookMove(board, playerA)) != NULL) { /*no search, so no counters to log and no replies to ponder on*/
+		memset(&noStats, 0, sizeof(noStats));
+		setSearchStats(noStats);
+		setPvTable(noReplies);
+		return move;
+	}
+	return selectMove(miniMax_lst(board, depth, playerA, currentPlayer, LIST_BEST, limits));
+}
 
-move_t* miniMax_env(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer) {
+/* pick the move to play out of miniMax_lst's best moves, and free the rest of the list
+ * @post: returns NULL for minimax error (moves==NULL) or no moves */
+move_t* selectMove(movesList_t* moves) {
 	move_t* move = NULL;
-	movesList_t *nextMove, *moves;
+	movesList_t *nextMove;
 
-	moves = miniMax_lst(board, depth, playerA, currentPlayer, LIST_BEST);
-	if (moves==NULL || isEmpty(moves)) /*minimax error*/
+	if (moves==NULL || isEmpty(moves)) { /*minimax error*/
+		freeList(moves);
 		return NULL;
+	}
 
 	/* randomize selection in case of multiple options */
 	int r = (rand() % moves->size);
@@ -247,29 +462,103 @@ move_t* miniMax_env(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char pla
 
 }
 
-int scoringFunction(char board[BOARD_SIZE][BOARD_SIZE], char playerA, char currentPlayer, int depth, int realDepth){
-	unsigned pieces[12];
-	int score = 0, white = 0, black = 0, maxWhite, maximize;
+/* used by miniMax_rec on the first level below the root, to remember the best reply found so far */
+void recordReply(move_t* reply) {
+	pvLast.root = reply; /*any non NULL value marks a reply as found, set to actual root move later*/
+	pvLast.from = reply->curr;
+	pvLast.to = reply->next->curr;
+	pvLast.special = reply->special;
+}
+
+/* store pvLast as the reply for its root move, replacing the one from a shallower search */
+void recordRootReply() {
+	unsigned i;
+	if (pvTable.replies == NULL) /*replies are disabled for this search*/
+		return;
+	for (i=0 ; i<pvTable.size && pvTable.replies[i].root!=pvLast.root ; i++);
+	pvTable.replies[i] = pvLast;
+	if (i == pvTable.size)
+		pvTable.size++;
+}
+
+/* return the expected reply to move (a root move of the last miniMax_lst in this thread)
+ * @post: returns a newly allocated move, or NULL if no reply is known or on allocation error */
+move_t* getPonderMove(move_t* move) {
+	move_t* reply = NULL;
+	for (unsigned i=0 ; i<pvTable.size ; i++) {
+		if (pvTable.replies[i].root != move) /*compare by address*/
+			continue;
+		if ((reply = addPosToMove(NULL, pvTable.replies[i].from)) == NULL)
+			return NULL;
+		if (addPosToMove(reply, pvTable.replies[i].to) == NULL) {
+			freeMove(reply);
+			return NULL;
+		}
+		reply->special = reply->next->special = pvTable.replies[i].special;
+		break;
+	}
+	return reply;
+}
+
+/* hand over this thread's replies table to another thread (see setPvTable) */
+pvTable_t takePvTable() {
+	pvTable_t table = pvTable;
+	pvTable.replies = NULL;
+	pvTable.size = 0;
+	return table;
+}
+
+/* replace this thread's replies table with one taken from another thread */
+void setPvTable(pvTable_t table) {
+	free(pvTable.replies);
+	pvTable = table;
+}
+
+/* score board for playerA, alpha and beta are the window of the calling node (from playerA's side)
+ * BEST adds expensive positional terms only when the cheap material and piece-square score is within
+ * LAZY_MARGIN of the window, otherwise they can't change whether the node fails high or low
+ * (slowScore is clamped to +-LAZY_MARGIN) */
+int scoringFunction(char board[BOARD_SIZE][BOARD_SIZE], char playerA, char currentPlayer, int depth, int realDepth, \
+		int alpha, int beta){
+	posState_t local, *state = &posState;
+	int score = 0, white = 0, black = 0, positional = 0, maxWhite, maximize, limit;
 	int eval;
 	char player;
+	unsigned long long key;
+	evalEntry_t* entry;
 
+	mmStats.leaves++;
 	maxWhite = (WHITE == playerA) ? 1 : -1; /* For white player - score is correct. For black player - should negate */
 	maximize = (currentPlayer == PLAYER_A) ? 1 : -1; /* if A is current - score is correct. If B is current - should negate */
 	player = maxWhite==maximize? WHITE:BLACK; /*current player is white/black*/
-	countPieces(board, pieces); /*Will fill unsigned answer[12] - [m,n,b,r,q,k,M,N,B,R,Q,K]*/
+	if (board != posState.board) { /*not searched by this thread, count from scratch*/
+		computePosState(board, &local);
+		state = &local;
+	}
 
-	if (depth != BEST) { /*For minimax depth 0-4*/
-		/*(M)pawn = 1 , kNight = 3 , Bishop = 3 , Rook = 5, Queen = 9, King=400*/
-		white = pieces[0] + pieces[1] * 3 + pieces[2] * 3 + pieces[3] * 5 + pieces[4] * 9 + pieces[5] * 400;
-		black = pieces[6] + pieces[7] * 3 + pieces[8] * 3 + pieces[9] * 5 + pieces[10] * 9 + pieces[11] * 400;
+	if (depth != BEST) { /*For minimax depth 0-4, weights in position.c*/
+		white = state->material[0];
+		black = state->material[1];
 	}
 	else { /* BEST - uses better scoring for knight and rook, but with a x10 factor to avoid fp numbers */
-		/* basic score */
-		white = pieces[0]*10 + pieces[1]*33 + pieces[2]*34 + pieces[3]*50 + pieces[4]*90;
-		black = pieces[6]*10 + pieces[7]*33 + pieces[8]*34 + pieces[9]*50 + pieces[10]*90;
+		white = state->materialBest[0];
+		black = state->materialBest[1];
+		positional = pstScore(state);
 	} /* we must later adjust WIN/TIE scores with 10x factor, just to make sure they are the highest */
 
-	eval=evalBoard(board,player);
+	key = positionKey(state, player);
+	entry = &evalCache[key & (EVAL_CACHE_SIZE-1)];
+	if (entry->key == key) {
+		mmStats.evalHits++;
+		eval = entry->eval;
+	} else {
+		eval = evalBoard(board,player);
+		if (eval != -1) { /*don't keep allocation errors*/
+			entry->key = key;
+			entry->eval = eval;
+			entry->hasSlow = 0;
+		}
+	}
 
 	switch(eval) {
 		case WHITE:
@@ -282,8 +571,27 @@ int scoringFunction(char board[BOARD_SIZE][BOARD_SIZE], char playerA, char curre
 		case CHECK:
 			if (depth==BEST && white==0 && black==0) { /* best sees 2 kings as tie */
 				score = TIE_B*maximize;
-			} else
-				score = (white-black)*maxWhite;
+				break;
+			}
+			if (useNnue(depth)) { /*network replaces material and positional scoring, kept below WIN/TIE*/
+				limit = NNUE_LIMIT*(depth==BEST? 10:1);
+				score = nnueEvaluate(state->nnuePly, board) / (depth==BEST? 10:100); /*centipawns to scale*/
+				score = score>limit? limit : score<-limit? -limit:score;
+				score *= maxWhite;
+				break;
+			}
+			score = (white-black+positional)*maxWhite;
+			if (depth==BEST) {
+				if (score+LAZY_MARGIN < alpha || score-LAZY_MARGIN > beta) /*written so MIN_INF/MAX_INF can't overflow*/
+					mmStats.lazyExits++;
+				else {
+					if (!entry->hasSlow) { /*entry was filled above or on an earlier hit*/
+						entry->slow = slowScore(board, state);
+						entry->hasSlow = 1;
+					}
+					score += entry->slow*maxWhite;
+				}
+			}
 			break;
 		case TIE:
 			score = TIE_B*maximize;
@@ -295,7 +603,7 @@ int scoringFunction(char board[BOARD_SIZE][BOARD_SIZE], char playerA, char curre
 	/* adjust WIN/TIE scores with 10x factor for BEST */
 	if (depth==BEST && (eval==WHITE || eval==BLACK || eval==TIE)) {
 		score = score*10;
-		/*add estimate to depth from maxBoards - the shorter it took to get the best score, the better*/
+		/*add bonus for plies from the root - the shorter it took to get the best score, the better*/
 		if (eval!=TIE) {
 			realDepth = DEPTH_FACTOR-realDepth;
 			realDepth = realDepth>0? realDepth:0;
@@ -309,3 +617,104 @@ int scoringFunction(char board[BOARD_SIZE][BOARD_SIZE], char playerA, char curre
 	return score;
 }
 
+/*bonus for a passed pawn by rows advanced from its starting row*/
+static const int passedPawn[BOARD_SIZE] = {0, 0, 1, 2, 4, 6, 9, 0};
+
+/* expensive terms of BEST's scoring, white minus black, x10 scale, clamped to +-LAZY_MARGIN so that
+ * skipping them (see scoringFunction) never changes a node's result
+ * @pre: state describes board */
+int slowScore(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state) {
+	int score = (mobilityScore(board, 0) - mobilityScore(board, 1))/MOBILITY_DIV + \
+			kingSafetyScore(board, state, 0) - kingSafetyScore(board, state, 1) + \
+			pawnScore(board, state);
+	return score>LAZY_MARGIN? LAZY_MARGIN : score<-LAZY_MARGIN? -LAZY_MARGIN:score;
+}
+
+/* pawnStructureScore, looked up by the pawns alone since they rarely change between nodes */
+int pawnScore(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state) {
+	pawnEntry_t* entry = &pawnCache[state->pawnHash & (PAWN_CACHE_SIZE-1)];
+
+	mmStats.pawnProbes++;
+	if (entry->key == state->pawnHash && state->pawnHash != 0) {
+		mmStats.pawnHits++;
+		return entry->score;
+	}
+	entry->key = state->pawnHash;
+	entry->score = pawnStructureScore(board, state);
+	return entry->score;
+}
+
+/* number of squares side's (0 white, 1 black) knights, bishops, rooks and queens can move to,
+ * ignoring checks and pins, from the attack map the node's legality checks already built */
+int mobilityScore(char board[BOARD_SIZE][BOARD_SIZE], int side) {
+	return getAttackMap(board)->mobility[side];
+}
+
+/* bonus for side's (0 white, 1 black) pawns right in front of its king, while the opponent has a queen */
+int kingSafetyScore(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state, int side) {
+	int shield = 0, col, row;
+	char pawn = side==0? W_PAWN:B_PAWN;
+
+	if (state->count[side]==0 || state->pieces[side==0? 10:4]==0) /*no king, or no queen to attack it*/
+		return 0;
+	col = squareCol(state->squares[side][0]);
+	row = squareRow(state->squares[side][0]) + (side==0? 1:-1);
+	for (int c=col-1 ; c<=col+1 ; c++)
+		if (inBoard(c, row) && board[c][row]==pawn)
+			shield++;
+	return shield*KING_SHIELD;
+}
+
+/* true iff side's pawn at col,row has no own pawns beside or behind it on the columns next to it,
+ * and an opponent pawn attacks the square in front of it (so it can't advance to its neighbours) */
+static int isBackwardPawn(char board[BOARD_SIZE][BOARD_SIZE], int col, int row, int side) {
+	int step = side==0? 1:-1, stop = row+step;
+	char pawn = side==0? W_PAWN:B_PAWN, opponent = side==0? B_PAWN:W_PAWN;
+
+	for (int c=col-1 ; c<=col+1 ; c+=2)
+		for (int r=row ; inBoard(c, r) ; r-=step)
+			if (board[c][r] == pawn)
+				return 0;
+	for (int c=col-1 ; c<=col+1 ; c+=2)
+		if (inBoard(c, stop+step) && board[c][stop+step] == opponent)
+			return 1;
+	return 0;
+}
+
+/* doubled, isolated, backward and passed pawns, white minus black */
+int pawnStructureScore(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state) {
+	int files[2][BOARD_SIZE+2] = {{0}}; /*pawns per column, with an empty column on each side*/
+	int score[2] = {0, 0}, col, row, step, ahead;
+	char pawns[2] = {W_PAWN, B_PAWN};
+
+	for (int side=0 ; side<2 ; side++) {
+		for (unsigned i=0 ; i<state->count[side] ; i++)
+			if (board[squareCol(state->squares[side][i])][squareRow(state->squares[side][i])] == pawns[side])
+				files[side][squareCol(state->squares[side][i])+1]++;
+	}
+	for (int side=0 ; side<2 ; side++) {
+		step = side==0? 1:-1; /*forward*/
+		for (unsigned i=0 ; i<state->count[side] ; i++) {
+			col = squareCol(state->squares[side][i]);
+			row = squareRow(state->squares[side][i]);
+			if (board[col][row] != pawns[side])
+				continue;
+			if (files[side][col]==0 && files[side][col+2]==0) {
+				score[side] -= ISOLATED_PAWN;
+			} else if (isBackwardPawn(board, col, row, side)) {
+				score[side] -= BACKWARD_PAWN;
+			}
+			/*passed if no opponent pawn is ahead of it on its own or the adjacent columns*/
+			ahead = 0;
+			for (int c=col-1 ; c<=col+1 && !ahead ; c++)
+				for (int r=row+step ; inBoard(c, r) && !ahead ; r+=step)
+					ahead = board[c][r]==pawns[1-side];
+			if (!ahead)
+				score[side] += passedPawn[side==0? row:BOARD_SIZE-1-row];
+		}
+		for (col=1 ; col<=BOARD_SIZE ; col++)
+			if (files[side][col] > 1)
+				score[side] -= (files[side][col]-1)*DOUBLED_PAWN;
+	}
+	return score[0]-score[1];
+}
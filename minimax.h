@@ -7,14 +7,20 @@
 /* contents: minimax and scoring function				  */
 /**********************************************************/
 #include "chessprog.h"
+#include "trace.h"
+#include "position.h"
+#include "nnue.h"
+#include "attack.h"
+#include "arena.h"
+#include "movepick.h"
 #include <limits.h>
 #ifndef MINIMAX_H_
 #define MINIMAX_H_
 
-#define DEBUG_MM 0
 #define DEBUG_MM_SCORE 0
 
 #define MM_ERROR (20*WIN_A) /*set impossible score as minimax error code*/
+#define MM_ABORT (21*WIN_A) /*impossible score returned when search was stopped from outside*/
 
 #define PLAYER_A 'A'
 #define PLAYER_B 'B'
@@ -22,8 +28,19 @@
 #define WIN_B -1000
 #define TIE_A -999
 #define TIE_B 999
+#define DRAW_SCORE 0 /*a draw known without searching it (tablebases, isDrawnMaterial), even for both sides unlike TIE_A/TIE_B*/
 #define MM_LIMIT 1000000 /*boards limit for minimax best*/
+#define BEST_MIN_DEPTH 4 /*plies always searched by minimax best, regardless of MM_LIMIT*/
 #define DEPTH_FACTOR 6
+#define NNUE_LIMIT (WIN_A-100) /*network scores are clipped to this, x10 for BEST*/
+
+/*expensive terms of BEST's scoring, x10 scale*/
+#define LAZY_MARGIN 30 /*bound of the expensive terms, skipped when the cheap score is this far outside the window*/
+#define MOBILITY_DIV 3 /*squares a piece can reach per point*/
+#define KING_SHIELD 2 /*per own pawn in front of the king, while the opponent has a queen*/
+#define DOUBLED_PAWN 2 /*per pawn beyond the first on a column*/
+#define ISOLATED_PAWN 2 /*per pawn with no own pawns on the columns next to it*/
+#define BACKWARD_PAWN 1 /*per pawn behind its neighbours that can't safely step forward*/
 
 #define MIN_INF INT_MIN
 #define MAX_INF INT_MAX
@@ -31,12 +48,97 @@
 #define LIST_ALL 1   /*used to return all moves and their score*/
 #define LIST_BEST 0  /*used to return just moved with best score*/
 
+#define EVAL_CACHE_SIZE (1<<15) /*entries of each thread's evaluation cache, power of 2*/
+#define PAWN_CACHE_SIZE (1<<12) /*entries of each thread's pawn structure cache, power of 2*/
+#define TT_SIZE (1<<15) /*entries of each thread's transposition table, power of 2*/
+
+#define LIMITS_CHECK 4096 /*nodes between checks of deadline and stop flag, power of 2*/
+
+typedef struct { /*optional limits for a single search, a 0/NULL field means no limit*/
+	unsigned maxDepth; /*plies from the root, caps depth (or the plies searched by BEST)*/
+	unsigned long maxNodes; /*boards visited by miniMax_rec*/
+	long deadline; /*absolute time, as returned by getTimeMs*/
+	volatile int* stop; /*external stop flag, search stops once it is set*/
+} searchLimits_t;
+
+typedef struct { /*counters for a single search*/
+	unsigned long nodes; /*boards visited by miniMax_rec*/
+	unsigned long leaves; /*calls to scoringFunction*/
+	unsigned long moveGens; /*calls to getAllLegalMoves, and boards whose moves were generated past the hash move*/
+	unsigned long ttHits; /*positions found in the transposition table*/
+	unsigned long tbHits; /*positions scored by the endgame tablebases*/
+	unsigned long drawCuts; /*positions scored as ties by their material, see isDrawnMaterial*/
+	unsigned long cutoffs; /*alpha-beta prunings*/
+	unsigned long firstCutoffs; /*prunings on the first move tried*/
+	unsigned long lazyExits; /*leaves scored without the expensive terms*/
+	unsigned long evalHits; /*leaves whose evaluation was found in the evaluation cache*/
+	unsigned long pawnProbes; /*pawn structure scores asked for*/
+	unsigned long pawnHits; /*pawn structure scores found in the pawn cache*/
+	unsigned plies; /*depth of the deepest completed search*/
+	long time; /*milliseconds*/
+} searchStats_t;
+
+typedef struct { /*evaluation cache entry, the parts of scoringFunction that depend only on the position*/
+	unsigned long long key; /*positionKey, 0 for an empty entry*/
+	int slow; /*slowScore, valid if hasSlow*/
+	char eval; /*evalBoard*/
+	char hasSlow;
+} evalEntry_t;
+
+typedef struct { /*pawn cache entry*/
+	unsigned long long key; /*pawnHash, 0 for an empty entry*/
+	int score; /*pawnStructureScore*/
+} pawnEntry_t;
+
+typedef struct { /*transposition table entry, only used to order moves so it never changes a score*/
+	unsigned long long key; /*positionKey*/
+	unsigned age; /*search that stored it, entries of earlier searches are ignored (see initSearch)*/
+	hashMove_t move; /*best move found for the position*/
+} ttEntry_t;
+
+typedef struct { /*user's expected reply to a root move, taken from the principal variation*/
+	move_t* root; /*root move the reply belongs to, compared by address*/
+	pos_t from;
+	pos_t to;
+	char special;
+} pvReply_t;
+
+typedef struct { /*replies for all root moves of the last search*/
+	pvReply_t* replies;
+	unsigned size;
+} pvTable_t;
+
+
+extern THREAD_LOCAL searchStats_t mmStats;
+
 movesList_t* keepBestMoves(movesList_t* answer, int bestScore);
-int scoringFunction(char board[BOARD_SIZE][BOARD_SIZE], char playerA, char currentPlayer, int depth, int realDepth);
-movesList_t* miniMax_lst(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer, char returnList);
+int scoringFunction(char board[BOARD_SIZE][BOARD_SIZE], char playerA, char currentPlayer, int depth, int realDepth, \
+		int alpha, int beta);
+int slowScore(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state);
+int mobilityScore(char board[BOARD_SIZE][BOARD_SIZE], int side);
+int kingSafetyScore(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state, int side);
+int pawnScore(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state);
+int pawnStructureScore(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state);
+movesList_t* miniMax_lst(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer, \
+		char returnList, searchLimits_t* limits);
 int miniMax_move(move_t* move, char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer);
-move_t* miniMax_env(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer);
+move_t* miniMax_env(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer, \
+		searchLimits_t* limits);
+void initSearch(searchLimits_t* limits);
+int searchAborted();
+void finishSearch();
+searchStats_t getSearchStats();
+void setSearchStats(searchStats_t stats);
+move_t* selectMove(movesList_t* moves);
+void recordReply(move_t* reply);
+void recordRootReply();
+move_t* getPonderMove(move_t* move);
+pvTable_t takePvTable();
+void setPvTable(pvTable_t table);
 int miniMax_rec(char board[BOARD_SIZE][BOARD_SIZE], unsigned depth, char playerA, char currentPlayer, \
-		int alpha, int beta, int maxBoards, int realDepth);
+		int alpha, int beta, int realDepth);
+int searchRoot(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* moves, unsigned depth, char playerA, char currentPlayer);
+int searchBest(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* moves, char playerA, char currentPlayer, \
+		searchLimits_t* limits);
 
 #endif /* MINIMAX_H_ */
@@ -0,0 +1,435 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 movepick.c                                   */
+/* contents: staged move generation for the search        */
+/**********************************************************/
+#include "movepick.h"
+#include "minimax.h"
+#include "scan.h"
+#include "tables.h"
+
+#define VICTIM_FACTOR 8 /*captures are ordered by victim type, then by attacker type (MVV-LVA)*/
+
+/* add the move from-to, with its ordering score, to the start of list
+ * @post: returns NULL on allocation error (list is freed) */
+static movesList_t* addPickedMove(movesList_t* list, int from, int to, char special, int score) {
+	move_t* move;
+	movesList_t* tmpList;
+	pos_t pos;
+
+	pos.col = squareCol(from);
+	pos.row = squareRow(from);
+	if ((move = addPosToMove(NULL, pos)) == NULL) {
+		freeList(list);
+		return NULL; /*allocation error*/
+	}
+	pos.col = squareCol(to);
+	pos.row = squareRow(to);
+	if (addPosToMove(move, pos) == NULL || (tmpList = addMoveToMoves(list, move)) == NULL) {
+		freeMove(move);
+		freeList(list);
+		return NULL; /*allocation error*/
+	}
+	move->special = move->next->special = special;
+	move->score = score;
+	return tmpList;
+}
+
+/* Generators of one side's moves, instantiated below for white and black so the pawn direction, the
+ * promotion and home rows, the castling flags and the color tests are constants. Callers pick the side
+ * once per board (see addMoves), only single pieces are looked up by their color (see addPieceMoves).
+ * OWN is the side's BLACK_PIECE bit, KING_MOVED, LEFT_MOVED and RIGHT_MOVED its castling flags. */
+#define SIDE_GENERATORS(SIDE, OWN, DIR, PROMOTION_ROW, HOME_ROW, KING_MOVED, LEFT_MOVED, RIGHT_MOVED) \
+ \
+/* same as addPieceMoves##SIDE for a pawn, promotions are added with the captures */ \
+static movesList_t* addPawnMoves##SIDE(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* list, int from, \
+		int captures, unsigned long long targets) { \
+	int col = squareCol(from), row = squareRow(from)+DIR; \
+	char target; \
+ \
+	if (!inBoard(col, row)) /*can't happen in a game, a pawn on the last row has no moves*/ \
+		return list; \
+	for (int c=col-1 ; c<=col+1 && list!=NULL ; c++) { \
+		if (!inBoard(c, row) || !(targets & squareBit(toSquare(c, row)))) \
+			continue; \
+		target = board[c][row]; \
+		if (c==col? target!=EMPTY : (target==EMPTY || (target&BLACK_PIECE)==OWN)) \
+			continue; \
+		if (row==PROMOTION_ROW && captures) /*queen, rook, bishop and knight*/ \
+			for (char p=QUEEN ; p>=KNIGHT && list!=NULL ; p--) \
+				list = addPickedMove(list, from, toSquare(c, row), OWN|p, VICTIM_FACTOR*(pieceType(target)+p)-PAWN); \
+		else if (row!=PROMOTION_ROW && (c!=col) == (captures!=0)) \
+			list = addPickedMove(list, from, toSquare(c, row), NORM, VICTIM_FACTOR*pieceType(target)-PAWN); \
+	} \
+	return list; \
+} \
+ \
+/* add the captures and promotions (captures!=0) or the quiet moves of the piece on square from to list, \
+ * only those landing on a square of targets and not checked for leaving the king attacked. \
+ * Castling isn't added, see addCastlingMoves##SIDE. \
+ * @post: returns NULL on allocation error (list is freed) */ \
+static movesList_t* addPieceMoves##SIDE(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* list, int from, \
+		int captures, unsigned long long targets) { \
+	int col = squareCol(from), row = squareRow(from), c, r, to; \
+	char piece = board[col][row], target; \
+ \
+	switch (pieceType(piece)) { \
+	case PAWN: \
+		return addPawnMoves##SIDE(board, list, from, captures, targets); \
+	case KNIGHT: \
+	case KING: \
+		targets &= pieceType(piece)==KNIGHT? knightAttacks[from] : kingAttacks[from]; \
+		for (; targets && list!=NULL ; targets &= targets-1) { \
+			to = firstSquare(targets); \
+			target = board[squareCol(to)][squareRow(to)]; \
+			if (target==EMPTY? !captures : (captures && (target&BLACK_PIECE)!=OWN)) \
+				list = addPickedMove(list, from, to, NORM, VICTIM_FACTOR*pieceType(target)-pieceType(piece)); \
+		} \
+		return list; \
+	} \
+	for (int d=pieceAttr(piece).firstStep ; d<pieceAttr(piece).lastStep && list!=NULL ; d++) { \
+		for (c=col+pieceSteps[d][0], r=row+pieceSteps[d][1] ; inBoard(c, r) ; c+=pieceSteps[d][0], r+=pieceSteps[d][1]) { \
+			target = board[c][r]; \
+			if ((targets & squareBit(toSquare(c, r))) && \
+					(target==EMPTY? !captures : (captures && (target&BLACK_PIECE)!=OWN))) \
+				list = addPickedMove(list, from, toSquare(c, r), NORM, VICTIM_FACTOR*pieceType(target)-pieceType(piece)); \
+			if (target!=EMPTY || list==NULL) \
+				break; \
+		} \
+	} \
+	return list; \
+} \
+ \
+/* same as addPieceMoves##SIDE for the n pieces on squares */ \
+static movesList_t* addMoves##SIDE(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* list, \
+		unsigned char* squares, unsigned n, int captures, unsigned long long targets) { \
+	for (unsigned i=0 ; i<n && list!=NULL ; i++) \
+		list = addPieceMoves##SIDE(board, list, squares[i], captures, targets); \
+	return list; \
+} \
+ \
+/* home squares holding the side's rooks, a rook taken at home leaves its castling flag clear */ \
+static unsigned long long homeRooks##SIDE(char board[BOARD_SIZE][BOARD_SIZE]) { \
+	return (board[0][HOME_ROW]==(OWN|ROOK)? squareBit(toSquare(0, HOME_ROW)) : 0) | \
+			(board[7][HOME_ROW]==(OWN|ROOK)? squareBit(toSquare(7, HOME_ROW)) : 0); \
+} \
+ \
+/* add the castling moves of the rooks starting on a square of rooks to list. Castling is a rook move, the \
+ * king goes next to the rook on its other side (see playMove) and may not start on, pass or land on a \
+ * square the opponent attacks. \
+ * @post: returns NULL on allocation error (list is freed) */ \
+static movesList_t* addCastlingMoves##SIDE(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* list, \
+		unsigned long long rooks) { \
+	unsigned long long attacked; \
+ \
+	if (KING_MOVED || list==NULL) \
+		return list; \
+	attacked = getAttackMap(board)->attacks[pieceSide(OWN^BLACK_PIECE)]; \
+	if (!RIGHT_MOVED && (rooks & squareBit(toSquare(7, HOME_ROW))) && \
+			board[5][HOME_ROW]==EMPTY && board[6][HOME_ROW]==EMPTY && !(attacked & (squareBit(toSquare(4, HOME_ROW)) | \
+			squareBit(toSquare(5, HOME_ROW)) | squareBit(toSquare(6, HOME_ROW))))) \
+		list = addPickedMove(list, toSquare(7, HOME_ROW), toSquare(5, HOME_ROW), CASTLE, 0); \
+	if (!LEFT_MOVED && (rooks & squareBit(toSquare(0, HOME_ROW))) && list!=NULL && \
+			board[2][HOME_ROW]==EMPTY && board[3][HOME_ROW]==EMPTY && !(attacked & (squareBit(toSquare(4, HOME_ROW)) | \
+			squareBit(toSquare(3, HOME_ROW)) | squareBit(toSquare(2, HOME_ROW))))) \
+		list = addPickedMove(list, toSquare(0, HOME_ROW), toSquare(3, HOME_ROW), CASTLE, 0); \
+	return list; \
+}
+
+SIDE_GENERATORS(White, 0, 1, BOARD_SIZE-1, 0, wk, wlr, wrr)
+SIDE_GENERATORS(Black, BLACK_PIECE, -1, 0, BOARD_SIZE-1, bk, blr, brr)
+
+/* addMoves of the side of color */
+static movesList_t* addMoves(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* list, char color, \
+		unsigned char* squares, unsigned n, int captures, unsigned long long targets) {
+	if (color == WHITE)
+		return addMovesWhite(board, list, squares, n, captures, targets);
+	return addMovesBlack(board, list, squares, n, captures, targets);
+}
+
+/* addCastlingMoves of the side of color */
+static movesList_t* addCastlingMoves(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* list, char color, \
+		unsigned long long rooks) {
+	if (color == WHITE)
+		return addCastlingMovesWhite(board, list, rooks);
+	return addCastlingMovesBlack(board, list, rooks);
+}
+
+/* addPieceMoves of the side of the piece on square from */
+static movesList_t* addPieceMoves(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* list, int from, \
+		int captures, unsigned long long targets) {
+	if (getColor(board[squareCol(from)][squareRow(from)]) == WHITE)
+		return addPieceMovesWhite(board, list, from, captures, targets);
+	return addPieceMovesBlack(board, list, from, captures, targets);
+}
+
+/* squares of the opposing pieces that attack color's king on square king, the squares between the king
+ * and a sliding one are added to *block */
+static unsigned long long getCheckers(char board[BOARD_SIZE][BOARD_SIZE], char color, int king, unsigned long long* block) {
+	unsigned long long checkers = 0, occupied = ~scanPiece(board, EMPTY), blockers;
+	int s;
+	char p;
+
+	*block = 0;
+	for (int d=0 ; d<8 ; d++) { /*sliders, rook directions first (see pieceSteps)*/
+		if ((blockers = rays[d][king] & occupied) == 0)
+			continue;
+		s = rayStep(d)>0? firstSquare(blockers) : lastSquare(blockers); /*nearest piece*/
+		if (getColor(p=board[squareCol(s)][squareRow(s)])==color)
+			continue;
+		if (pieceType(p)==QUEEN || pieceType(p)==(d<4? ROOK:BISHOP)) {
+			checkers |= squareBit(s);
+			*block |= rays[d][king] & ~rays[d][s] & ~squareBit(s);
+		}
+	}
+	checkers |= knightAttacks[king] & scanPiece(board, color==WHITE? B_KNIGHT:W_KNIGHT);
+	/*a pawn attacks the king from the squares the king would attack as a pawn of color*/
+	checkers |= pawnAttacks[colorSide(color)][king] & scanPiece(board, color==WHITE? B_PAWN:W_PAWN);
+	return checkers;
+}
+
+/* add the moves that may answer a check of color's king to list: king moves to squares the opponent
+ * doesn't attack and, against a single checker, captures of it and moves onto the squares between it
+ * and the king. Not checked for pins, see getEvasions.
+ * @post: returns NULL on allocation error (list is freed) */
+static movesList_t* addEvasions(char board[BOARD_SIZE][BOARD_SIZE], movesList_t* list, char color) {
+	attackMap_t* map = getAttackMap(board);
+	int king = map->king[colorSide(color)];
+	unsigned long long safe = ~map->attacks[colorSide(invColor(color))], block, checkers;
+	unsigned char squares[MAX_SIDE_PIECES];
+	unsigned n;
+
+	checkers = getCheckers(board, color, king, &block);
+	n = getPieceSquares(board, color, squares); /*king first*/
+	/*the map's sliders see through the king, so it can't step back along a checking line*/
+	list = addMoves(board, list, color, squares, 1, 0, safe);
+	list = addMoves(board, list, color, squares, 1, 1, safe);
+	if (checkers & (checkers-1)) /*double check, only the king can move*/
+		return list;
+	list = addMoves(board, list, color, squares+1, n-1, 0, checkers | block);
+	return addMoves(board, list, color, squares+1, n-1, 1, checkers | block);
+}
+
+/* legal moves of color while its king is in check, generateMoves uses this instead of trying every move
+ * of every piece
+ * @pre: inCheck(getAttackMap(board), color)
+ * @post: returns NULL on allocation error */
+movesList_t* getEvasions(char board[BOARD_SIZE][BOARD_SIZE], char color) {
+	movesList_t* list = addEvasions(board, initEmptyList(), color);
+	if (list != NULL)
+		keepAllLegalMoves(board, list, color);
+	return list;
+}
+
+/* castling moves of color, 0, 1 or 2 (see addCastlingMovesWhite)
+ * @post: returns NULL on allocation error */
+movesList_t* getCastlingMoves(char board[BOARD_SIZE][BOARD_SIZE], char color) {
+	if (color == WHITE)
+		return addCastlingMovesWhite(board, initEmptyList(), homeRooksWhite(board));
+	return addCastlingMovesBlack(board, initEmptyList(), homeRooksBlack(board));
+}
+
+/* legal moves of color on board, captures and promotions first and castling last (see getAllLegalMoves)
+ * @post: returns NULL on allocation error */
+movesList_t* generateMoves(char board[BOARD_SIZE][BOARD_SIZE], char color) {
+	unsigned char squares[MAX_SIDE_PIECES];
+	unsigned n;
+	movesList_t* list;
+
+	if (inCheck(getAttackMap(board), color)) /*few moves answer a check, only those are generated*/
+		return getEvasions(board, color);
+	n = getPieceSquares(board, color, squares);
+	list = getCastlingMoves(board, color); /*moves are added to the start of the list, so last ones first*/
+	list = addMoves(board, list, color, squares, n, 0, ~0ULL);
+	list = addMoves(board, list, color, squares, n, 1, ~0ULL);
+	if (list != NULL)
+		keepAllLegalMoves(board, list, color);
+	return list;
+}
+
+/* legal moves of the piece on square from (see getMovesForPiece), a king gets the castling moves of its
+ * side (see getCastlingMoves) and a rook the one it castles with
+ * @pre: board[squareCol(from)][squareRow(from)] != EMPTY
+ * @post: returns NULL on allocation error */
+movesList_t* generatePieceMoves(char board[BOARD_SIZE][BOARD_SIZE], int from) {
+	char piece = board[squareCol(from)][squareRow(from)];
+	movesList_t* list;
+
+	if (pieceType(piece) == KING)
+		list = getCastlingMoves(board, getColor(piece));
+	else /*only a rook on its home square can castle*/
+		list = addCastlingMoves(board, initEmptyList(), getColor(piece), pieceType(piece)==ROOK? squareBit(from) : 0);
+	list = addPieceMoves(board, list, from, 0, ~0ULL);
+	list = addPieceMoves(board, list, from, 1, ~0ULL);
+	if (list != NULL)
+		keepAllLegalMoves(board, list, getColor(piece));
+	return list;
+}
+
+/* true iff move is the hash move of picker */
+static int isHashMove(movePicker_t* picker, move_t* move) {
+	return toSquare(move->curr.col, move->curr.row)==picker->hash.from && \
+			toSquare(move->next->curr.col, move->next->curr.row)==picker->hash.to && move->special==picker->hash.special;
+}
+
+/* list holding the hash move if it's legal on the board, empty otherwise (then the hash move is dropped) */
+static movesList_t* hashStage(movePicker_t* picker) {
+	hashMove_t* hash = &picker->hash;
+	char piece = picker->board[squareCol(hash->from)][squareRow(hash->from)];
+	char target = picker->board[squareCol(hash->to)][squareRow(hash->to)];
+	movesList_t *list, *nextMove, *answer;
+
+	if (hash->from==hash->to || piece==EMPTY || getColor(piece)!=picker->color) { /*none, or another position's*/
+		hash->to = hash->from;
+		return initEmptyList();
+	}
+	/*generate the piece's moves of the hash move's kind, keep the hash move if it's among them and legal*/
+	if ((list = addPieceMoves(picker->board, initEmptyList(), hash->from, target!=EMPTY || hash->special!=NORM, \
+			squareBit(hash->to))) == NULL)
+		return NULL;
+	for (nextMove=list ; !isEmpty(nextMove) && !isHashMove(picker, nextMove->curr) ; nextMove=nextMove->next);
+	if ((answer = initEmptyList()) == NULL) {
+		freeList(list);
+		return NULL;
+	}
+	if (!isEmpty(nextMove)) {
+		addMoveToMoves(answer, nextMove->curr); /*can't fail on an empty list*/
+		freeListWithException(list, nextMove->curr);
+		keepAllLegalMoves(picker->board, answer, picker->color);
+	} else
+		freeList(list);
+	if (isEmpty(answer))
+		hash->to = hash->from;
+	return answer;
+}
+
+/* move the quiet moves of list that give check to its front */
+static void checksFirst(movePicker_t* picker, movesList_t* list) {
+	checkInfo_t info;
+	movesList_t *nextMove, *front = list;
+	move_t* swap;
+
+	computeCheckInfo(picker->board, picker->color, &info);
+	for (nextMove=list ; !isEmpty(nextMove) ; nextMove=nextMove->next)
+		if (givesCheck(picker->board, &info, nextMove->curr)) {
+			swap = front->curr;
+			front->curr = nextMove->curr;
+			nextMove->curr = swap;
+			front = front->next;
+		}
+}
+
+/* legal moves of stage for the side of picker, without the hash move
+ * @post: returns NULL on allocation error */
+static movesList_t* generateStage(movePicker_t* picker, int stage) {
+	unsigned char squares[MAX_SIDE_PIECES];
+	unsigned n;
+	movesList_t *list, *nextMove;
+
+	switch (stage) {
+	case PICK_HASH:
+		return hashStage(picker);
+	case PICK_CAPTURES:
+	case PICK_QUIETS:
+		if (stage == PICK_CAPTURES) {
+			mmStats.moveGens++;
+			picker->evasions = inCheck(getAttackMap(picker->board), picker->color);
+		}
+		list = initEmptyList();
+		if (picker->evasions) { /*all answers to the check are handed out with the captures*/
+			if (stage == PICK_CAPTURES)
+				list = addEvasions(picker->board, list, picker->color);
+			break;
+		}
+		n = getPieceSquares(picker->board, picker->color, squares);
+		list = addMoves(picker->board, list, picker->color, squares, n, stage==PICK_CAPTURES, ~0ULL);
+		break;
+	default: /*PICK_CASTLING*/
+		if (picker->evasions) /*can't castle out of check*/
+			return initEmptyList();
+		list = getCastlingMoves(picker->board, picker->color);
+	}
+	if (list == NULL)
+		return NULL; /*allocation error*/
+	if (stage == PICK_QUIETS)
+		checksFirst(picker, list);
+	if (picker->hash.from != picker->hash.to) /*already handed out*/
+		for (nextMove=list ; !isEmpty(nextMove) ; nextMove=nextMove->next)
+			if (isHashMove(picker, nextMove->curr)) {
+				deleteMoveFromList(nextMove->curr, list);
+				break;
+			}
+	keepAllLegalMoves(picker->board, list, picker->color);
+	return list;
+}
+
+/* start handing out the legal moves of color on board, nothing is generated before nextPickedMove
+ * hash is tried first if it's legal, its from==to for none */
+void initPicker(movePicker_t* picker, char board[BOARD_SIZE][BOARD_SIZE], char color, hashMove_t hash) {
+	picker->board = board;
+	picker->color = color;
+	picker->stage = PICK_HASH;
+	picker->evasions = 0;
+	picker->hash = hash;
+	for (int i=0 ; i<PICK_STAGES ; i++)
+		picker->lists[i] = NULL;
+	picker->next = NULL;
+	picker->size = 0;
+	picker->generated = 0;
+}
+
+/* next legal move, stages are generated when the previous ones are used up
+ * @pre: board is as it was at initPicker (moves handed out were undone)
+ * @post: returns the list entry of the move, valid until freePicker, or NULL once all moves were handed out
+ *        or on allocation error (then picker->stage is PICK_ERROR) */
+movesList_t* nextPickedMove(movePicker_t* picker) {
+	movesList_t *entry, *best, *list;
+	move_t* swap;
+
+	while (picker->next == NULL) { /*stage is used up*/
+		if (picker->stage >= PICK_DONE)
+			return NULL;
+		if (picker->lists[(int)picker->stage] != NULL && ++picker->stage == PICK_DONE)
+			return NULL;
+		if ((list = generateStage(picker, picker->stage)) == NULL) {
+			picker->stage = PICK_ERROR;
+			return NULL;
+		}
+		picker->lists[(int)picker->stage] = list;
+		picker->generated += list->size;
+		picker->next = isEmpty(list)? NULL:list;
+	}
+
+	entry = picker->next;
+	if (picker->stage == PICK_CAPTURES) { /*bring the best capture left to the front*/
+		for (best=entry, list=entry->next ; list!=NULL ; list=list->next)
+			if (list->curr->score > best->curr->score)
+				best = list;
+		swap = entry->curr;
+		entry->curr = best->curr;
+		best->curr = swap;
+	}
+	picker->next = entry->next;
+	picker->size++;
+	return entry;
+}
+
+/* free the moves of all stages generated */
+void freePicker(movePicker_t* picker) {
+	for (int i=0 ; i<PICK_STAGES ; i++) {
+		freeList(picker->lists[i]);
+		picker->lists[i] = NULL;
+	}
+}
+
+/* move as kept in the transposition table, castling isn't kept (it's tried last anyway) */
+hashMove_t toHashMove(move_t* move) {
+	hashMove_t hash;
+	hash.from = toSquare(move->curr.col, move->curr.row);
+	hash.to = move->special==CASTLE? hash.from:toSquare(move->next->curr.col, move->next->curr.row);
+	hash.special = move->special;
+	return hash;
+}
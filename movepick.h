@@ -0,0 +1,53 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 movepick.h                                   */
+/* contents: staged move generation for the search        */
+/**********************************************************/
+#include "attack.h"
+#ifndef MOVEPICK_H_
+#define MOVEPICK_H_
+
+/* A picker hands out the legal moves of a side one at a time and generates them in stages, so a node
+ * that is cut off early never generates the rest: the hash move first, then captures and promotions
+ * (most valuable victim first), then quiet moves, and castling last. All stages together give the
+ * moves of generateMoves (getAllLegalMoves), each once. A side in check gets the moves of getEvasions
+ * instead of captures, quiet moves and castling. */
+
+#define PICK_HASH 0
+#define PICK_CAPTURES 1
+#define PICK_QUIETS 2
+#define PICK_CASTLING 3
+#define PICK_STAGES 4
+#define PICK_DONE PICK_STAGES
+#define PICK_ERROR (PICK_STAGES+1) /*allocation error, picker hands out nothing more*/
+
+typedef struct { /*move to try before generating any, from the transposition table*/
+	unsigned char from, to; /*squares (see toSquare), from==to for none*/
+	char special;
+} hashMove_t;
+
+typedef struct { /*state of a staged generation, see nextPickedMove*/
+	char (*board)[BOARD_SIZE];
+	char color;
+	char stage; /*stage of list, PICK_DONE once all moves were handed out*/
+	char evasions; /*side is in check, only moves that may answer it are generated (see getEvasions)*/
+	hashMove_t hash; /*from==to if there is none or it's not legal*/
+	movesList_t* lists[PICK_STAGES]; /*moves of each stage generated so far, kept until freePicker*/
+	movesList_t* next; /*next entry of the current stage's list to hand out, NULL when it's used up*/
+	unsigned size; /*moves handed out so far*/
+	unsigned generated; /*legal moves generated so far*/
+} movePicker_t;
+
+void initPicker(movePicker_t* picker, char board[BOARD_SIZE][BOARD_SIZE], char color, hashMove_t hash);
+movesList_t* nextPickedMove(movePicker_t* picker);
+void freePicker(movePicker_t* picker);
+hashMove_t toHashMove(move_t* move);
+movesList_t* getEvasions(char board[BOARD_SIZE][BOARD_SIZE], char color);
+movesList_t* generateMoves(char board[BOARD_SIZE][BOARD_SIZE], char color);
+movesList_t* generatePieceMoves(char board[BOARD_SIZE][BOARD_SIZE], int from);
+movesList_t* getCastlingMoves(char board[BOARD_SIZE][BOARD_SIZE], char color);
+
+#endif /* MOVEPICK_H_ */
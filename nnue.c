@@ -0,0 +1,196 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 nnue.c                                       */
+/* contents: efficiently updatable network evaluation     */
+/**********************************************************/
+#include "nnue.h"
+#include "position.h"
+
+#if defined(__AVX2__) && !defined(NNUE_SCALAR)
+#include <immintrin.h>
+#define NNUE_AVX2
+#elif defined(__SSE2__) && !defined(NNUE_SCALAR)
+#include <emmintrin.h>
+#define NNUE_SSE2
+#endif
+
+char nnueLevels[BEST+1] = {0};
+
+/*network, read only once loaded (load only from settings, when no search is running)*/
+static int nnueLoaded = 0;
+static short inputWeights[NNUE_INPUTS][NNUE_HIDDEN];
+static short inputBias[NNUE_HIDDEN];
+static short hiddenWeights[NNUE_HIDDEN2][NNUE_HIDDEN];
+static int hiddenBias[NNUE_HIDDEN2];
+static short outputWeights[NNUE_HIDDEN2];
+static int outputBias;
+
+/*first layer sums, one per ply of the board searched by this thread (see posState.nnuePly)*/
+static THREAD_LOCAL short accumulators[NNUE_MAX_PLY][NNUE_HIDDEN];
+
+/******************* kernels ************************/
+
+/* acc += w, n is a multiple of 16 */
+static void vecAdd(short* acc, const short* w, int n) {
+#if defined(NNUE_AVX2)
+	for (int i=0 ; i<n ; i+=16)
+		_mm256_storeu_si256((__m256i*)(acc+i), _mm256_add_epi16(_mm256_loadu_si256((__m256i*)(acc+i)), \
+				_mm256_loadu_si256((const __m256i*)(w+i))));
+#elif defined(NNUE_SSE2)
+	for (int i=0 ; i<n ; i+=8)
+		_mm_storeu_si128((__m128i*)(acc+i), _mm_add_epi16(_mm_loadu_si128((__m128i*)(acc+i)), \
+				_mm_loadu_si128((const __m128i*)(w+i))));
+#else
+	for (int i=0 ; i<n ; i++)
+		acc[i] += w[i];
+#endif
+}
+
+/* acc -= w, n is a multiple of 16 */
+static void vecSub(short* acc, const short* w, int n) {
+#if defined(NNUE_AVX2)
+	for (int i=0 ; i<n ; i+=16)
+		_mm256_storeu_si256((__m256i*)(acc+i), _mm256_sub_epi16(_mm256_loadu_si256((__m256i*)(acc+i)), \
+				_mm256_loadu_si256((const __m256i*)(w+i))));
+#elif defined(NNUE_SSE2)
+	for (int i=0 ; i<n ; i+=8)
+		_mm_storeu_si128((__m128i*)(acc+i), _mm_sub_epi16(_mm_loadu_si128((__m128i*)(acc+i)), \
+				_mm_loadu_si128((const __m128i*)(w+i))));
+#else
+	for (int i=0 ; i<n ; i++)
+		acc[i] -= w[i];
+#endif
+}
+
+/* out = in clipped to [0,NNUE_CLIP], n is a multiple of 16 */
+static void vecClip(short* out, const short* in, int n) {
+#if defined(NNUE_AVX2)
+	__m256i zero = _mm256_setzero_si256(), clip = _mm256_set1_epi16(NNUE_CLIP);
+	for (int i=0 ; i<n ; i+=16)
+		_mm256_storeu_si256((__m256i*)(out+i), _mm256_min_epi16(_mm256_max_epi16( \
+				_mm256_loadu_si256((const __m256i*)(in+i)), zero), clip));
+#elif defined(NNUE_SSE2)
+	__m128i zero = _mm_setzero_si128(), clip = _mm_set1_epi16(NNUE_CLIP);
+	for (int i=0 ; i<n ; i+=8)
+		_mm_storeu_si128((__m128i*)(out+i), _mm_min_epi16(_mm_max_epi16( \
+				_mm_loadu_si128((const __m128i*)(in+i)), zero), clip));
+#else
+	for (int i=0 ; i<n ; i++)
+		out[i] = in[i]<0? 0 : in[i]>NNUE_CLIP? NNUE_CLIP:in[i];
+#endif
+}
+
+/* sum of a[i]*b[i] in 32 bits, n is a multiple of 16 and a is clipped so pairs can't overflow */
+static int vecDot(const short* a, const short* b, int n) {
+#if defined(NNUE_AVX2)
+	__m256i sum = _mm256_setzero_si256();
+	__m128i half;
+	for (int i=0 ; i<n ; i+=16)
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_loadu_si256((const __m256i*)(a+i)), \
+				_mm256_loadu_si256((const __m256i*)(b+i))));
+	half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(half);
+#elif defined(NNUE_SSE2)
+	__m128i sum = _mm_setzero_si128();
+	for (int i=0 ; i<n ; i+=8)
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(a+i)), \
+				_mm_loadu_si128((const __m128i*)(b+i))));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+#else
+	int sum = 0;
+	for (int i=0 ; i<n ; i++)
+		sum += a[i]*b[i];
+	return sum;
+#endif
+}
+
+/******************* network ************************/
+
+/* read network from the weights file at path (see nnue.h for its format)
+ * @post: return 0 on success, -1 if the file is missing, short or for another network size */
+int nnueLoad(const char* path) {
+	char magic[4];
+	int header[4];
+	FILE* fp;
+
+	nnueLoaded = 0;
+	if ((fp = fopen(path, "rb")) == NULL)
+		return -1;
+	if (fread(magic, sizeof(magic), 1, fp) == 1 && strncmp(magic, NNUE_MAGIC, 4) == 0 && \
+			fread(header, sizeof(header), 1, fp) == 1 && header[0] == NNUE_VERSION && \
+			header[1] == NNUE_INPUTS && header[2] == NNUE_HIDDEN && header[3] == NNUE_HIDDEN2 && \
+			fread(inputWeights, sizeof(inputWeights), 1, fp) == 1 && \
+			fread(inputBias, sizeof(inputBias), 1, fp) == 1 && \
+			fread(hiddenWeights, sizeof(hiddenWeights), 1, fp) == 1 && \
+			fread(hiddenBias, sizeof(hiddenBias), 1, fp) == 1 && \
+			fread(outputWeights, sizeof(outputWeights), 1, fp) == 1 && \
+			fread(&outputBias, sizeof(outputBias), 1, fp) == 1)
+		nnueLoaded = 1;
+	fclose(fp);
+	return nnueLoaded? 0:-1;
+}
+
+/* true iff a network is loaded and selected for difficulty depth */
+int useNnue(unsigned depth) {
+	return nnueLoaded && depth<=BEST && nnueLevels[depth];
+}
+
+static void refresh(short* acc, char board[BOARD_SIZE][BOARD_SIZE]) {
+	int piece;
+	memcpy(acc, inputBias, sizeof(inputBias));
+	for (int i=0 ; i<BOARD_SIZE ; i++)
+		for (int j=0 ; j<BOARD_SIZE ; j++)
+			if ((piece = pieceIndex(board[i][j])) != -1)
+				vecAdd(acc, inputWeights[piece*BOARD_SIZE*BOARD_SIZE + toSquare(i, j)], NNUE_HIDDEN);
+}
+
+/* compute the accumulator of ply from scratch for board */
+void nnueRefresh(int ply, char board[BOARD_SIZE][BOARD_SIZE]) {
+	refresh(accumulators[ply], board);
+}
+
+/* start the accumulator of the next ply as a copy of ply's, called before a move's features change
+ * @post: return the next ply, NNUE_NONE if ply has no accumulator or there's no room for another one */
+int nnuePush(int ply) {
+	if (ply == NNUE_NONE || ply+1 >= NNUE_MAX_PLY)
+		return NNUE_NONE;
+	memcpy(accumulators[ply+1], accumulators[ply], sizeof(accumulators[ply]));
+	return ply+1;
+}
+
+/* piece (pieceIndex) was put on square */
+void nnueAddFeature(int ply, int piece, int square) {
+	vecAdd(accumulators[ply], inputWeights[piece*BOARD_SIZE*BOARD_SIZE + square], NNUE_HIDDEN);
+}
+
+/* piece (pieceIndex) was taken off square */
+void nnueSubFeature(int ply, int piece, int square) {
+	vecSub(accumulators[ply], inputWeights[piece*BOARD_SIZE*BOARD_SIZE + square], NNUE_HIDDEN);
+}
+
+/* score of board for white in centipawns, using the accumulator of ply, or one built from scratch
+ * for ply==NNUE_NONE
+ * @pre: a network is loaded */
+int nnueEvaluate(int ply, char board[BOARD_SIZE][BOARD_SIZE]) {
+	short scratch[NNUE_HIDDEN], input[NNUE_HIDDEN], hidden[NNUE_HIDDEN2];
+	short* acc = accumulators[ply==NNUE_NONE? 0:ply];
+	int sum;
+
+	if (ply == NNUE_NONE) {
+		refresh(scratch, board);
+		acc = scratch;
+	}
+	vecClip(input, acc, NNUE_HIDDEN);
+	for (int i=0 ; i<NNUE_HIDDEN2 ; i++) {
+		sum = (vecDot(input, hiddenWeights[i], NNUE_HIDDEN) + hiddenBias[i]) >> NNUE_SHIFT;
+		hidden[i] = sum<0? 0 : sum>NNUE_CLIP? NNUE_CLIP:sum;
+	}
+	return (vecDot(hidden, outputWeights, NNUE_HIDDEN2) + outputBias) >> NNUE_SHIFT;
+}
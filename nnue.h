@@ -0,0 +1,43 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 nnue.h                                       */
+/* contents: efficiently updatable network evaluation     */
+/**********************************************************/
+#include "chessprog.h"
+#ifndef NNUE_H_
+#define NNUE_H_
+
+/* Network: 768 piece-square inputs (12 pieces x 64 squares, white's view) -> NNUE_HIDDEN int16 accumulator,
+ * clipped to [0,NNUE_CLIP] -> NNUE_HIDDEN2 dense units, shifted right by NNUE_SHIFT and clipped -> 1 output.
+ * Output shifted right by NNUE_SHIFT is the score of the position for white in centipawns.
+ *
+ * Weights file, native byte order:
+ *   char magic[4] "CNNU", int version, int inputs, int hidden, int hidden2 (must match the defines below)
+ *   short inputWeights[inputs][hidden], short inputBias[hidden]
+ *   short hiddenWeights[hidden2][hidden], int hiddenBias[hidden2]
+ *   short outputWeights[hidden2], int outputBias */
+
+#define NNUE_MAGIC "CNNU"
+#define NNUE_VERSION 1
+#define NNUE_INPUTS (12*BOARD_SIZE*BOARD_SIZE)
+#define NNUE_HIDDEN 64 /*multiple of 16, for the AVX2 kernels*/
+#define NNUE_HIDDEN2 16
+#define NNUE_CLIP 127
+#define NNUE_SHIFT 6
+#define NNUE_MAX_PLY 128 /*accumulators kept per thread, deeper boards are evaluated from scratch*/
+#define NNUE_NONE -1 /*posState.nnuePly of a board without an up to date accumulator*/
+
+extern char nnueLevels[BEST+1]; /*nnueLevels[depth] set if the network replaces scoring at that difficulty*/
+
+int nnueLoad(const char* path);
+int useNnue(unsigned depth);
+void nnueRefresh(int ply, char board[BOARD_SIZE][BOARD_SIZE]);
+int nnuePush(int ply);
+void nnueAddFeature(int ply, int piece, int square);
+void nnueSubFeature(int ply, int piece, int square);
+int nnueEvaluate(int ply, char board[BOARD_SIZE][BOARD_SIZE]);
+
+#endif /* NNUE_H_ */
@@ -0,0 +1,97 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 ponder.c                                     */
+/* contents: background search on the user's time         */
+/**********************************************************/
+#include "ponder.h"
+
+static ponderJob_t job;
+static pthread_t thread;
+static int pondering = 0;
+
+/* guess the user's reply to the computer's move (already played on board) and start
+ * searching the resulting position for the computer in the background
+ * @pre: move is the computer's move, as returned by miniMax_env in this thread
+ * @post: return 1 if pondering started, 0 if no reply is known or on error */
+int ponderStart(char board[BOARD_SIZE][BOARD_SIZE], move_t* move) {
+	move_t* reply;
+	saveCastlingFlags();
+
+	ponderStop(); /*only one search in the background*/
+	if ((reply = getPonderMove(move)) == NULL) /*no reply known (depth 1) or allocation error*/
+		return 0;
+
+	copyBoard(job.board, board);
+	playMove(job.board, reply);
+	copyBoard(job.predicted, job.board);
+	job.wk=wk; job.wlr=wlr; job.wrr=wrr; job.bk=bk; job.blr=blr; job.brr=brr;
+	restoreCastlingFlags();
+	freeMove(reply);
+
+	job.depth = minimaxDepth;
+	job.playerA = computerColor;
+	job.stop = 0;
+	job.result = NULL;
+	job.pvTable.replies = NULL;
+	job.pvTable.size = 0;
+	if (pthread_create(&thread, NULL, ponderThread, &job) != 0)
+		return 0; /*just play without pondering*/
+	pondering = 1;
+	return 1;
+}
+
+/* called on the computer's turn with the board after the user's move
+ * @post: on ponderhit wait for the background search and return the selected move,
+ *        otherwise stop it and return NULL (caller should search from scratch) */
+move_t* ponderHit(char board[BOARD_SIZE][BOARD_SIZE]) {
+	if (!pondering)
+		return NULL;
+	if (memcmp(board, job.predicted, sizeof(job.predicted))!=0 || wk!=job.wk || wlr!=job.wlr || \
+			wrr!=job.wrr || bk!=job.bk || blr!=job.blr || brr!=job.brr || \
+			minimaxDepth!=job.depth || computerColor!=job.playerA) {
+		ponderStop(); /*user played something else*/
+		return NULL;
+	}
+	pthread_join(thread, NULL); /*let the search finish*/
+	pondering = 0;
+	addPoolStats(job.pool.stats); /*free lists stay in job for the next ponder thread*/
+	memset(&job.pool.stats, 0, sizeof(job.pool.stats));
+	setPvTable(job.pvTable); /*so we can keep pondering after this move*/
+	setSearchStats(job.stats);
+	return selectMove(job.result);
+}
+
+/* stop and discard the background search, if there is one */
+void ponderStop() {
+	if (!pondering)
+		return;
+	job.stop = 1;
+	pthread_join(thread, NULL);
+	pondering = 0;
+	addPoolStats(job.pool.stats); /*free lists stay in job for the next ponder thread*/
+	memset(&job.pool.stats, 0, sizeof(job.pool.stats));
+	freeList(job.result);
+	free(job.pvTable.replies);
+}
+
+void* ponderThread(void* arg) {
+	ponderJob_t* j = (ponderJob_t*)arg;
+	searchLimits_t limits = {0, 0, 0, NULL};
+
+	/*castling flags are per thread, start from the predicted position*/
+	wk=j->wk; wlr=j->wlr; wrr=j->wrr; bk=j->bk; blr=j->blr; brr=j->brr;
+	limits.stop = &j->stop;
+	mergePool(j->pool);
+	j->result = miniMax_lst(j->board, j->depth, j->playerA, PLAYER_A, LIST_BEST, &limits);
+	if (j->stop) { /*partial result is of no use*/
+		freeList(j->result);
+		j->result = NULL;
+	}
+	j->pvTable = takePvTable();
+	j->stats = getSearchStats();
+	j->pool = takePool(); /*slabs outlive the thread*/
+	return NULL;
+}
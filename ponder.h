@@ -0,0 +1,37 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 ponder.h                                     */
+/* contents: background search on the user's time         */
+/**********************************************************/
+#include "chessprog.h"
+#include "minimax.h"
+#include "pool.h"
+#ifndef PONDER_H_
+#define PONDER_H_
+
+#include <pthread.h>
+
+#define PONDER 0 /*default for ponderMode, toggled by the "ponder" setting*/
+
+typedef struct {
+	char board[BOARD_SIZE][BOARD_SIZE]; /*searched by the ponder thread, restored when done*/
+	char predicted[BOARD_SIZE][BOARD_SIZE]; /*board we expect after the user's reply*/
+	char wk, wlr, wrr, bk, blr, brr; /*castling flags expected after the user's reply*/
+	unsigned depth;
+	char playerA;
+	volatile int stop;
+	movesList_t* result; /*miniMax_lst result, NULL on error or when stopped*/
+	pvTable_t pvTable; /*ponder thread's expected replies, passed on upon ponderhit*/
+	searchStats_t stats; /*ponder thread's search counters, passed on upon ponderhit*/
+	pool_t pool; /*ponder thread's free lists, kept from one ponder thread to the next, and its counters*/
+} ponderJob_t;
+
+int ponderStart(char board[BOARD_SIZE][BOARD_SIZE], move_t* move);
+move_t* ponderHit(char board[BOARD_SIZE][BOARD_SIZE]);
+void ponderStop();
+void* ponderThread(void* job);
+
+#endif /* PONDER_H_ */
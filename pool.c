@@ -0,0 +1,110 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 pool.c                                       */
+/* contents: free lists of move list nodes and counters   */
+/**********************************************************/
+#include "pool.h"
+
+char poolMode = POOL_MODE;
+
+static THREAD_LOCAL pool_t pool;
+static const size_t nodeSizes[POOL_KINDS] = {sizeof(move_t), sizeof(movesList_t)};
+
+/* put a new slab of kind's nodes on the free list
+ * @post: return -1 on allocation error, 0 otherwise */
+static int refill(int kind) {
+	size_t size = nodeSizes[kind]>sizeof(poolNode_t)? nodeSizes[kind]:sizeof(poolNode_t);
+	char* slab = (char*)malloc(POOL_SLAB_NODES*size);
+
+	if (slab == NULL)
+		return -1; /*allocation error code*/
+	for (int i=POOL_SLAB_NODES-1 ; i>=0 ; i--) { /*first node of the slab is handed out first*/
+		((poolNode_t*)(slab+i*size))->next = pool.free[kind];
+		pool.free[kind] = (poolNode_t*)(slab+i*size);
+	}
+	pool.stats.slabs++;
+	pool.stats.slabBytes += POOL_SLAB_NODES*size;
+	return 0;
+}
+
+/* @post: return a node of kind (POOL_MOVE or POOL_LIST), NULL on allocation error */
+void* poolAlloc(int kind) {
+	poolNode_t* node;
+
+	if (!poolMode)
+		node = (poolNode_t*)malloc(nodeSizes[kind]);
+	else if (pool.free[kind] != NULL || refill(kind) == 0) {
+		node = pool.free[kind];
+		pool.free[kind] = node->next;
+	} else
+		node = NULL;
+	if (node == NULL)
+		return NULL; /*allocation error code*/
+
+	pool.stats.allocs++;
+	pool.stats.live++;
+	pool.stats.liveBytes += nodeSizes[kind];
+	if (pool.stats.live > pool.stats.peakLive)
+		pool.stats.peakLive = pool.stats.live;
+	if (pool.stats.liveBytes > pool.stats.peakBytes)
+		pool.stats.peakBytes = pool.stats.liveBytes;
+	return node;
+}
+
+/* give back a node of kind returned by poolAlloc */
+void poolFree(void* node, int kind) {
+	pool.stats.frees++;
+	pool.stats.live--;
+	pool.stats.liveBytes -= nodeSizes[kind];
+	if (!poolMode) {
+		free(node);
+		return;
+	}
+	((poolNode_t*)node)->next = pool.free[kind];
+	pool.free[kind] = (poolNode_t*)node;
+}
+
+/* counters of this thread, including those merged from other threads */
+poolStats_t getPoolStats() {
+	return pool.stats;
+}
+
+/* hand over this thread's free lists and counters to another thread (see mergePool), called by a
+ * thread before it exits so its slabs aren't lost */
+pool_t takePool() {
+	pool_t taken = pool;
+	memset(&pool, 0, sizeof(pool));
+	return taken;
+}
+
+/* add the free lists of a pool taken from another thread, and its counters, to this thread's */
+void mergePool(pool_t other) {
+	poolNode_t* last;
+
+	for (int kind=0 ; kind<POOL_KINDS ; kind++) {
+		if (other.free[kind] == NULL)
+			continue;
+		for (last=other.free[kind] ; last->next!=NULL ; last=last->next);
+		last->next = pool.free[kind];
+		pool.free[kind] = other.free[kind];
+	}
+	addPoolStats(other.stats);
+}
+
+/* add counters of another thread to this thread's */
+void addPoolStats(poolStats_t other) {
+	/*the other thread ran while this one waited, so its peaks are on top of what this one had live*/
+	if (pool.stats.live+other.peakLive > pool.stats.peakLive)
+		pool.stats.peakLive = pool.stats.live+other.peakLive;
+	if (pool.stats.liveBytes+other.peakBytes > pool.stats.peakBytes)
+		pool.stats.peakBytes = pool.stats.liveBytes+other.peakBytes;
+	pool.stats.allocs += other.allocs;
+	pool.stats.frees += other.frees;
+	pool.stats.live += other.live;
+	pool.stats.liveBytes += other.liveBytes;
+	pool.stats.slabs += other.slabs;
+	pool.stats.slabBytes += other.slabBytes;
+}
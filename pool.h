@@ -0,0 +1,53 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 pool.h                                       */
+/* contents: free lists of move list nodes and counters   */
+/**********************************************************/
+#include "chessprog.h"
+#ifndef POOL_H_
+#define POOL_H_
+
+/* Every move_t and movesList_t node not taken from an arena (see arena.h) is counted here. With
+ * poolMode set, freed nodes go on a free list of this thread instead of back to free(), and an empty
+ * list is refilled with a slab of POOL_SLAB_NODES nodes from a single malloc. Slabs are never given
+ * back, so a node may be freed by another thread than the one that allocated it. */
+
+#define POOL_MODE 0 /*default for poolMode, toggled by the "pool" setting*/
+#define POOL_SLAB_NODES 1024
+#define POOL_MOVE 0 /*node kinds*/
+#define POOL_LIST 1
+#define POOL_KINDS 2
+
+typedef struct poolNode_t { /*overlays a free node*/
+	struct poolNode_t* next;
+} poolNode_t;
+
+typedef struct {
+	unsigned long long allocs; /*nodes handed out*/
+	unsigned long long frees; /*nodes given back*/
+	long long live; /*allocs-frees*/
+	long long peakLive;
+	long long liveBytes; /*bytes of the live nodes*/
+	long long peakBytes;
+	unsigned long long slabs; /*slabs malloc'ed by the free lists*/
+	unsigned long long slabBytes;
+} poolStats_t;
+
+typedef struct {
+	poolNode_t* free[POOL_KINDS];
+	poolStats_t stats;
+} pool_t;
+
+extern char poolMode; /*only changed in settings, when no node is allocated*/
+
+void* poolAlloc(int kind);
+void poolFree(void* node, int kind);
+poolStats_t getPoolStats();
+pool_t takePool();
+void mergePool(pool_t pool);
+void addPoolStats(poolStats_t stats);
+
+#endif /* POOL_H_ */
@@ -0,0 +1,438 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 position.c                                   */
+/* contents: incrementally updated position state         */
+/**********************************************************/
+#include "position.h"
+#include "nnue.h"
+
+THREAD_LOCAL posState_t posState = {NULL};
+
+/*piece-square tables of BEST, x10 scale like pieceInfo's valueBest, [midgame/endgame][m,n,b,r,q,k]
+ *written as seen by white: first line is row 8, first column is a. black uses them mirrored*/
+static const signed char pst[PST_PHASES][6][BOARD_SIZE][BOARD_SIZE] = {
+	{ /*midgame*/
+		{ /*pawn*/
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 5,  5,  5,  5,  5,  5,  5,  5},
+			{ 1,  1,  2,  3,  3,  2,  1,  1},
+			{ 1,  1,  1,  3,  3,  1,  1,  1},
+			{ 0,  0,  0,  2,  2,  0,  0,  0},
+			{ 1, -1, -1,  0,  0, -1, -1,  1},
+			{ 1,  1,  1, -2, -2,  1,  1,  1},
+			{ 0,  0,  0,  0,  0,  0,  0,  0}
+		},
+		{ /*knight*/
+			{-5, -4, -3, -3, -3, -3, -4, -5},
+			{-4, -2,  0,  0,  0,  0, -2, -4},
+			{-3,  0,  1,  2,  2,  1,  0, -3},
+			{-3,  1,  2,  2,  2,  2,  1, -3},
+			{-3,  0,  2,  2,  2,  2,  0, -3},
+			{-3,  1,  1,  2,  2,  1,  1, -3},
+			{-4, -2,  0,  1,  1,  0, -2, -4},
+			{-5, -4, -3, -3, -3, -3, -4, -5}
+		},
+		{ /*bishop*/
+			{-2, -1, -1, -1, -1, -1, -1, -2},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-1,  0,  1,  1,  1,  1,  0, -1},
+			{-1,  1,  1,  1,  1,  1,  1, -1},
+			{-1,  0,  1,  1,  1,  1,  0, -1},
+			{-1,  1,  1,  1,  1,  1,  1, -1},
+			{-1,  1,  0,  0,  0,  0,  1, -1},
+			{-2, -1, -1, -1, -1, -1, -1, -2}
+		},
+		{ /*rook*/
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 1,  1,  1,  1,  1,  1,  1,  1},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{ 0,  0,  0,  1,  1,  0,  0,  0}
+		},
+		{ /*queen*/
+			{-2, -1, -1, -1, -1, -1, -1, -2},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-1,  0,  1,  1,  1,  1,  0, -1},
+			{-1,  0,  1,  1,  1,  1,  0, -1},
+			{ 0,  0,  1,  1,  1,  1,  0, -1},
+			{-1,  1,  1,  1,  1,  1,  0, -1},
+			{-1,  0,  1,  0,  0,  0,  0, -1},
+			{-2, -1, -1, -1, -1, -1, -1, -2}
+		},
+		{ /*king - stay behind the pawns*/
+			{-3, -4, -4, -5, -5, -4, -4, -3},
+			{-3, -4, -4, -5, -5, -4, -4, -3},
+			{-3, -4, -4, -5, -5, -4, -4, -3},
+			{-3, -4, -4, -5, -5, -4, -4, -3},
+			{-2, -3, -3, -4, -4, -3, -3, -2},
+			{-1, -2, -2, -2, -2, -2, -2, -1},
+			{ 2,  2,  0,  0,  0,  0,  2,  2},
+			{ 2,  3,  1,  0,  0,  1,  3,  2}
+		}
+	},
+	{ /*endgame*/
+		{ /*pawn - race to promotion*/
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 8,  8,  8,  8,  8,  8,  8,  8},
+			{ 5,  5,  5,  5,  5,  5,  5,  5},
+			{ 3,  3,  3,  3,  3,  3,  3,  3},
+			{ 2,  2,  2,  2,  2,  2,  2,  2},
+			{ 1,  1,  1,  1,  1,  1,  1,  1},
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 0,  0,  0,  0,  0,  0,  0,  0}
+		},
+		{ /*knight*/
+			{-5, -4, -3, -3, -3, -3, -4, -5},
+			{-4, -2,  0,  0,  0,  0, -2, -4},
+			{-3,  0,  1,  2,  2,  1,  0, -3},
+			{-3,  1,  2,  2,  2,  2,  1, -3},
+			{-3,  0,  2,  2,  2,  2,  0, -3},
+			{-3,  0,  1,  2,  2,  1,  0, -3},
+			{-4, -2,  0,  0,  0,  0, -2, -4},
+			{-5, -4, -3, -3, -3, -3, -4, -5}
+		},
+		{ /*bishop*/
+			{-2, -1, -1, -1, -1, -1, -1, -2},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-1,  0,  1,  1,  1,  1,  0, -1},
+			{-1,  0,  1,  2,  2,  1,  0, -1},
+			{-1,  0,  1,  2,  2,  1,  0, -1},
+			{-1,  0,  1,  1,  1,  1,  0, -1},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-2, -1, -1, -1, -1, -1, -1, -2}
+		},
+		{ /*rook*/
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 1,  1,  1,  1,  1,  1,  1,  1},
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 0,  0,  0,  0,  0,  0,  0,  0},
+			{ 0,  0,  0,  0,  0,  0,  0,  0}
+		},
+		{ /*queen*/
+			{-2, -1, -1, -1, -1, -1, -1, -2},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-1,  0,  1,  1,  1,  1,  0, -1},
+			{-1,  0,  1,  2,  2,  1,  0, -1},
+			{-1,  0,  1,  2,  2,  1,  0, -1},
+			{-1,  0,  1,  1,  1,  1,  0, -1},
+			{-1,  0,  0,  0,  0,  0,  0, -1},
+			{-2, -1, -1, -1, -1, -1, -1, -2}
+		},
+		{ /*king - come to the centre*/
+			{-5, -4, -3, -2, -2, -3, -4, -5},
+			{-3, -2, -1,  0,  0, -1, -2, -3},
+			{-3, -1,  2,  3,  3,  2, -1, -3},
+			{-3, -1,  3,  4,  4,  3, -1, -3},
+			{-3, -1,  3,  4,  4,  3, -1, -3},
+			{-3, -1,  2,  3,  3,  2, -1, -3},
+			{-3, -3,  0,  0,  0,  0, -3, -3},
+			{-5, -3, -3, -3, -3, -3, -3, -5}
+		}
+	}
+};
+
+/*random keys xored into posState.hash per piece on a square, and by positionKey for the rest of the state*/
+static unsigned long long zobristPieces[PIECE_TYPES][BOARD_SIZE*BOARD_SIZE];
+static unsigned long long zobristBlack; /*black to move*/
+static unsigned long long zobristCastling[6]; /*wk, wlr, wrr, bk, blr, brr*/
+
+/* fill the zobrist keys, called once by main before any search (keys are shared by all threads) */
+void initPosition() {
+	unsigned long long x = 0x9E3779B97F4A7C15ULL; /*fixed seed, same keys on every run*/
+
+	for (int i=0 ; i<PIECE_TYPES*BOARD_SIZE*BOARD_SIZE+7 ; i++) {
+		x ^= x>>12; x ^= x<<25; x ^= x>>27; /*xorshift64*/
+		if (i < PIECE_TYPES*BOARD_SIZE*BOARD_SIZE)
+			zobristPieces[i/(BOARD_SIZE*BOARD_SIZE)][i%(BOARD_SIZE*BOARD_SIZE)] = x*0x2545F4914F6CDD1DULL;
+		else if (i < PIECE_TYPES*BOARD_SIZE*BOARD_SIZE+6)
+			zobristCastling[i-PIECE_TYPES*BOARD_SIZE*BOARD_SIZE] = x*0x2545F4914F6CDD1DULL;
+		else
+			zobristBlack = x*0x2545F4914F6CDD1DULL;
+	}
+}
+
+/* key of state's board together with the player to move and the castling flags */
+unsigned long long positionKey(posState_t* state, char player) {
+	unsigned long long key = state->hash;
+	char flags[6] = {wk, wlr, wrr, bk, blr, brr};
+
+	if (player == BLACK)
+		key ^= zobristBlack;
+	for (int i=0 ; i<6 ; i++)
+		if (flags[i])
+			key ^= zobristCastling[i];
+	return key;
+}
+
+/* return index of piece in countPieces' order, -1 for EMPTY */
+int pieceIndex(char piece) {
+	return pieceAttr(piece).index;
+}
+
+/* table value of piece on square for phase, negated for black */
+static int pstValue(int phase, char piece, int square) {
+	if (pieceSide(piece) == 0)
+		return pst[phase][pieceType(piece)-1][BOARD_SIZE-1-squareRow(square)][squareCol(square)];
+	return -pst[phase][pieceType(piece)-1][squareRow(square)][squareCol(square)];
+}
+
+static void addPiece(posState_t* state, char piece, int square) {
+	int index = pieceIndex(piece);
+	state->pieces[index]++;
+	state->material[pieceSide(piece)] += pieceAttr(piece).value;
+	state->materialBest[pieceSide(piece)] += pieceAttr(piece).valueBest;
+	state->hash ^= zobristPieces[index][square];
+	if (pieceType(piece) == PAWN)
+		state->pawnHash ^= zobristPieces[index][square];
+	if (state->nnuePly != NNUE_NONE)
+		nnueAddFeature(state->nnuePly, index, square);
+	for (int phase=0 ; phase<PST_PHASES ; phase++)
+		state->pst[phase] += pstValue(phase, piece, square);
+}
+
+static void removePiece(posState_t* state, char piece, int square) {
+	int index = pieceIndex(piece);
+	state->pieces[index]--;
+	state->material[pieceSide(piece)] -= pieceAttr(piece).value;
+	state->materialBest[pieceSide(piece)] -= pieceAttr(piece).valueBest;
+	state->hash ^= zobristPieces[index][square];
+	if (pieceType(piece) == PAWN)
+		state->pawnHash ^= zobristPieces[index][square];
+	if (state->nnuePly != NNUE_NONE)
+		nnueSubFeature(state->nnuePly, index, square);
+	for (int phase=0 ; phase<PST_PHASES ; phase++)
+		state->pst[phase] -= pstValue(phase, piece, square);
+}
+
+static void addSquare(posState_t* state, int side, int square) {
+	state->slot[square] = state->count[side];
+	state->squares[side][state->count[side]++] = square;
+}
+
+/* remove square from side's list by moving the last entry into its slot
+ * @pre: square isn't the king's (kings are never captured, so it isn't first unless it's alone) */
+static void removeSquare(posState_t* state, int side, int square) {
+	int slot = state->slot[square], last = state->squares[side][--state->count[side]];
+	state->squares[side][slot] = last;
+	state->slot[last] = slot;
+}
+
+/* move piece from square to square in the lists and the tables */
+static void movePiece(posState_t* state, char piece, int from, int to) {
+	int slot = state->slot[from], index = pieceIndex(piece);
+	state->squares[pieceSide(piece)][slot] = to;
+	state->slot[to] = slot;
+	state->hash ^= zobristPieces[index][from] ^ zobristPieces[index][to];
+	if (pieceType(piece) == PAWN)
+		state->pawnHash ^= zobristPieces[index][from] ^ zobristPieces[index][to];
+	if (state->nnuePly != NNUE_NONE) {
+		nnueSubFeature(state->nnuePly, index, from);
+		nnueAddFeature(state->nnuePly, index, to);
+	}
+	for (int phase=0 ; phase<PST_PHASES ; phase++)
+		state->pst[phase] += pstValue(phase, piece, to) - pstValue(phase, piece, from);
+}
+
+/* fill state from scratch for board (state->board is left as is) */
+void computePosState(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state) {
+	memset(state->pieces, 0, sizeof(state->pieces));
+	state->material[0] = state->material[1] = 0;
+	state->materialBest[0] = state->materialBest[1] = 0;
+	state->count[0] = state->count[1] = 0;
+	state->pst[PST_MIDGAME] = state->pst[PST_ENDGAME] = 0;
+	state->hash = state->pawnHash = 0;
+	state->nnuePly = NNUE_NONE; /*see trackNnue*/
+	for (int i=0 ; i<BOARD_SIZE ; i++)
+		for (int j=0 ; j<BOARD_SIZE ; j++)
+			if (pieceType(board[i][j]) == KING) /*kings go first in the lists*/
+				addSquare(state, pieceSide(board[i][j]), toSquare(i, j));
+	for (int i=0 ; i<BOARD_SIZE ; i++)
+		for (int j=0 ; j<BOARD_SIZE ; j++)
+			if (board[i][j] != EMPTY) {
+				addPiece(state, board[i][j], toSquare(i, j));
+				if (pieceType(board[i][j]) != KING)
+					addSquare(state, pieceSide(board[i][j]), toSquare(i, j));
+			}
+}
+
+/* make posState describe board, and have playMove keep it up to date from now on
+ * @post: board==NULL stops tracking */
+void trackBoard(char board[BOARD_SIZE][BOARD_SIZE]) {
+	posState.board = board;
+	if (board != NULL)
+		computePosState(board, &posState);
+}
+
+/* also keep the network's accumulator up to date for the tracked board
+ * @pre: trackBoard was called with a board, a network is loaded */
+void trackNnue() {
+	nnueRefresh(0, posState.board);
+	posState.nnuePly = 0;
+}
+
+/* update posState for move, called by playMove on the tracked board before the move is played
+ * @pre: move is legal for playMove, board==posState.board */
+void updatePosState(char board[BOARD_SIZE][BOARD_SIZE], move_t* move) {
+	pos_t from=move->curr, to=move->next->curr;
+	char captured = board[to.col][to.row], piece = board[from.col][from.row];
+
+	if (posState.nnuePly != NNUE_NONE) /*keep the accumulator of the board before the move for unmake*/
+		posState.nnuePly = nnuePush(posState.nnuePly);
+	if (captured != EMPTY) {
+		removePiece(&posState, captured, toSquare(to.col, to.row));
+		removeSquare(&posState, pieceSide(captured), toSquare(to.col, to.row));
+	}
+	movePiece(&posState, piece, toSquare(from.col, from.row), toSquare(to.col, to.row));
+	if (move->special == CASTLE) { /*rook moved already, king goes next to it on the other side (see playMove)*/
+		movePiece(&posState, board[4][from.row], toSquare(4, from.row), \
+				toSquare(to.col + (to.col>4? 1:-1), from.row));
+	} else if (move->special != NORM) { /*pawn promotion*/
+		removePiece(&posState, piece, toSquare(to.col, to.row));
+		addPiece(&posState, move->special, toSquare(to.col, to.row));
+	}
+}
+
+/* keep in undo what playing move on board changes in posState (nothing if board isn't tracked)
+ * @pre: called before playMove(board, move) */
+void savePosState(char board[BOARD_SIZE][BOARD_SIZE], move_t* move, posUndo_t* undo) {
+	pos_t from=move->curr, to=move->next->curr;
+
+	if (board != posState.board) {
+		undo->from = -1;
+		return;
+	}
+	memcpy(undo->pieces, posState.pieces, sizeof(undo->pieces));
+	undo->material[0] = posState.material[0];
+	undo->material[1] = posState.material[1];
+	undo->materialBest[0] = posState.materialBest[0];
+	undo->materialBest[1] = posState.materialBest[1];
+	undo->hash = posState.hash;
+	undo->pawnHash = posState.pawnHash;
+	undo->nnuePly = posState.nnuePly;
+	undo->pst[PST_MIDGAME] = posState.pst[PST_MIDGAME];
+	undo->pst[PST_ENDGAME] = posState.pst[PST_ENDGAME];
+	undo->from = toSquare(from.col, from.row);
+	undo->to = toSquare(to.col, to.row);
+	undo->side = pieceSide(board[from.col][from.row]);
+	undo->capturedSlot = board[to.col][to.row]!=EMPTY? posState.slot[undo->to] : -1;
+	undo->kingFrom = undo->kingTo = -1;
+	if (move->special == CASTLE) { /*see updatePosState*/
+		undo->kingFrom = toSquare(4, from.row);
+		undo->kingTo = toSquare(to.col + (to.col>4? 1:-1), from.row);
+	}
+}
+
+/* take back the move undo was saved for, after it was played
+ * @pre: the board undo was saved for is still tracked */
+void restorePosState(posUndo_t* undo) {
+	int slot, last, side = 1-undo->side;
+
+	if (undo->from == -1)
+		return;
+	memcpy(posState.pieces, undo->pieces, sizeof(undo->pieces));
+	posState.material[0] = undo->material[0];
+	posState.material[1] = undo->material[1];
+	posState.materialBest[0] = undo->materialBest[0];
+	posState.materialBest[1] = undo->materialBest[1];
+	posState.hash = undo->hash;
+	posState.pawnHash = undo->pawnHash;
+	posState.nnuePly = undo->nnuePly;
+	posState.pst[PST_MIDGAME] = undo->pst[PST_MIDGAME];
+	posState.pst[PST_ENDGAME] = undo->pst[PST_ENDGAME];
+
+	/*lists in the reverse order of updatePosState*/
+	if (undo->kingFrom != -1) {
+		slot = posState.slot[undo->kingTo];
+		posState.squares[undo->side][slot] = undo->kingFrom;
+		posState.slot[undo->kingFrom] = slot;
+	}
+	slot = posState.slot[undo->to];
+	posState.squares[undo->side][slot] = undo->from;
+	posState.slot[undo->from] = slot;
+	if (undo->capturedSlot != -1) { /*the entry moved into its slot goes back to the end*/
+		slot = undo->capturedSlot;
+		last = posState.squares[side][slot];
+		posState.squares[side][posState.count[side]] = last;
+		posState.slot[last] = posState.count[side]++;
+		posState.squares[side][slot] = undo->to;
+		posState.slot[undo->to] = slot;
+	}
+}
+
+/* piece-square score of state (white minus black), midgame and endgame tables weighted by the
+ * material left: full midgame with all minor and major pieces on board, full endgame with none */
+int pstScore(posState_t* state) {
+	int phase = state->pieces[1] + state->pieces[2] + state->pieces[7] + state->pieces[8] + \
+			2*(state->pieces[3] + state->pieces[9]) + 4*(state->pieces[4] + state->pieces[10]);
+	phase = phase<PST_FULL_PHASE? phase:PST_FULL_PHASE;
+	return (state->pst[PST_MIDGAME]*phase + state->pst[PST_ENDGAME]*(PST_FULL_PHASE-phase))/PST_FULL_PHASE;
+}
+
+/* true iff the king on square is on the edge of the board */
+static int onEdge(int square) {
+	return squareCol(square)==0 || squareCol(square)==BOARD_SIZE-1 || squareRow(square)==0 || squareRow(square)==BOARD_SIZE-1;
+}
+
+/* true iff neither side can win on the board of state: no mate is possible with its material (bare kings,
+ * a single minor piece, only bishops all on squares of one color), or no mate can be forced with it (two
+ * knights against a bare king, a minor piece against a minor piece) while the kings it could be forced on
+ * are off the edge
+ * @pre: state tracks a board (see trackBoard) */
+int isDrawnMaterial(posState_t* state) {
+	int minors[2], bishopColors = 0, square;
+
+	if (state->pieces[0] || state->pieces[3] || state->pieces[4] || state->pieces[6] || state->pieces[9] || \
+			state->pieces[10] || state->pieces[5]!=1 || state->pieces[11]!=1) /*pawns, rooks, queens, or not a king each*/
+		return 0;
+	minors[0] = state->pieces[1] + state->pieces[2];
+	minors[1] = state->pieces[7] + state->pieces[8];
+	if (minors[0]+minors[1] <= 1)
+		return 1;
+	if (state->pieces[1]==0 && state->pieces[7]==0) {
+		for (int side=0 ; side<2 ; side++)
+			for (int i=1 ; i<state->count[side] ; i++) { /*squares[side][0] is the king*/
+				square = state->squares[side][i];
+				bishopColors |= 1 << (squareCol(square)+squareRow(square))%2;
+			}
+		if (bishopColors != 3)
+			return 1;
+	}
+	for (int side=0 ; side<2 ; side++)
+		if (minors[side]==0 && minors[1-side]==2 && state->pieces[side? 1:7]==2)
+			return !onEdge(state->squares[side][0]);
+	return minors[0]==1 && minors[1]==1 && !onEdge(state->squares[0][0]) && !onEdge(state->squares[1][0]);
+}
+
+/* fill squares with those of color's pieces on board, king first, from posState if board is tracked
+ * @post: return number of squares */
+unsigned getPieceSquares(char board[BOARD_SIZE][BOARD_SIZE], char color, unsigned char squares[MAX_SIDE_PIECES]) {
+	unsigned n = 0;
+
+	if (board == posState.board) {
+		memcpy(squares, posState.squares[colorSide(color)], posState.count[colorSide(color)]);
+		return posState.count[colorSide(color)];
+	}
+	/*a plain loop, scanColor and a scan for the king are no faster at the repo's -g build (see scanbench)*/
+	for (int i=0 ; i<BOARD_SIZE ; i++)
+		for (int j=0 ; j<BOARD_SIZE ; j++) {
+			if (board[i][j]==EMPTY || getColor(board[i][j])!=color)
+				continue;
+			if (pieceType(board[i][j]) == KING) {
+				memmove(squares+1, squares, n);
+				squares[0] = toSquare(i, j);
+			}
+			else
+				squares[n] = toSquare(i, j);
+			n++;
+		}
+	return n;
+}
@@ -0,0 +1,72 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 position.h                                   */
+/* contents: incrementally updated position state         */
+/**********************************************************/
+#include "chessprog.h"
+#ifndef POSITION_H_
+#define POSITION_H_
+
+#define PIECE_TYPES 12 /*index order is countPieces': [m,n,b,r,q,k,M,N,B,R,Q,K]*/
+#define pieceSide(P) (((P)&BLACK_PIECE)? 1:0) /*0 for white pieces, 1 for black*/
+#define colorSide(C) ((C)==WHITE? 0:1)
+#define MAX_SIDE_PIECES (BOARD_SIZE*BOARD_SIZE) /*a loaded game isn't limited to 16 pieces*/
+
+#define PST_PHASES 2 /*piece-square tables for the midgame and for the endgame*/
+#define PST_MIDGAME 0
+#define PST_ENDGAME 1
+#define PST_FULL_PHASE 24 /*phase of the opening set: 8 minor pieces, 4 rooks (x2) and 2 queens (x4)*/
+
+#define toSquare(C,R) ((C)*BOARD_SIZE+(R)) /*square index used by the piece lists*/
+#define squareCol(S) ((S)/BOARD_SIZE)
+#define squareRow(S) ((S)%BOARD_SIZE)
+
+typedef struct { /*state of a board kept up to date by playMove, see trackBoard*/
+	char (*board)[BOARD_SIZE]; /*tracked board, NULL for none*/
+	unsigned char pieces[PIECE_TYPES]; /*same as countPieces(board)*/
+	int material[2]; /*white and black sums with the weights of depth 1-4*/
+	int materialBest[2]; /*white and black sums with the x10 weights of BEST*/
+	unsigned long long hash; /*zobrist key of the pieces on board, see positionKey*/
+	unsigned long long pawnHash; /*zobrist key of the pawns alone*/
+	int nnuePly; /*accumulator of the board in nnue.c, NNUE_NONE if the network isn't used*/
+	int pst[PST_PHASES]; /*piece-square sums of BEST for both phases, white minus black*/
+	/*the lists are edited in place by updatePosState and restorePosState, a move never copies them*/
+	unsigned char squares[2][MAX_SIDE_PIECES]; /*white and black occupied squares, king first if there is one*/
+	unsigned char count[2]; /*used entries of squares*/
+	unsigned char slot[BOARD_SIZE*BOARD_SIZE]; /*index in squares of the piece on a square, if any*/
+} posState_t;
+
+typedef struct { /*what a move changes in posState, to take it back without copying the lists (see savePosState)*/
+	unsigned char pieces[PIECE_TYPES];
+	int material[2];
+	int materialBest[2];
+	unsigned long long hash;
+	unsigned long long pawnHash;
+	int nnuePly;
+	int pst[PST_PHASES];
+	signed char from, to; /*squares of the move, from is -1 if the board isn't tracked*/
+	signed char kingFrom, kingTo; /*squares of the king of a castle, -1 for other moves*/
+	signed char capturedSlot; /*index in squares of the captured piece, -1 if there is none*/
+	unsigned char side; /*of the moving piece*/
+} posUndo_t;
+
+/*state of the board searched by this thread, taken back with the board by saveLastMove/restoreLastMove*/
+extern THREAD_LOCAL posState_t posState;
+
+void initPosition();
+int pieceIndex(char piece);
+unsigned long long positionKey(posState_t* state, char player);
+void computePosState(char board[BOARD_SIZE][BOARD_SIZE], posState_t* state);
+void trackBoard(char board[BOARD_SIZE][BOARD_SIZE]);
+void trackNnue();
+void updatePosState(char board[BOARD_SIZE][BOARD_SIZE], move_t* move);
+void savePosState(char board[BOARD_SIZE][BOARD_SIZE], move_t* move, posUndo_t* undo);
+void restorePosState(posUndo_t* undo);
+int pstScore(posState_t* state);
+int isDrawnMaterial(posState_t* state);
+unsigned getPieceSquares(char board[BOARD_SIZE][BOARD_SIZE], char color, unsigned char squares[MAX_SIDE_PIECES]);
+
+#endif /* POSITION_H_ */
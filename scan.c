@@ -0,0 +1,107 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 scan.c                                       */
+/* contents: whole board scans                            */
+/**********************************************************/
+#include "scan.h"
+
+#if defined(__AVX2__) && !defined(SCAN_SCALAR)
+#include <immintrin.h>
+#define SCAN_AVX2
+#elif defined(__SSE2__) && !defined(SCAN_SCALAR)
+#include <emmintrin.h>
+#define SCAN_SSE2
+#endif
+
+/*white pieces are above EMPTY and below BLACK_PIECE, black pieces above it (see getColor)*/
+
+/* squares holding piece (EMPTY gives the empty squares) */
+unsigned long long scanPiece(char board[BOARD_SIZE][BOARD_SIZE], char piece) {
+	const char* p = &board[0][0];
+	unsigned long long mask = 0;
+#if defined(SCAN_AVX2)
+	__m256i v = _mm256_set1_epi8(piece);
+	for (int i=0 ; i<2 ; i++)
+		mask |= (unsigned long long)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8( \
+				_mm256_loadu_si256((const __m256i*)(p+32*i)), v)) << (32*i);
+#elif defined(SCAN_SSE2)
+	__m128i v = _mm_set1_epi8(piece);
+	for (int i=0 ; i<4 ; i++)
+		mask |= (unsigned long long)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8( \
+				_mm_loadu_si128((const __m128i*)(p+16*i)), v)) << (16*i);
+#else
+	for (int i=0 ; i<BOARD_SIZE*BOARD_SIZE ; i++)
+		if (p[i] == piece)
+			mask |= 1ULL << i;
+#endif
+	return mask;
+}
+
+/* squares holding a piece of color */
+unsigned long long scanColor(char board[BOARD_SIZE][BOARD_SIZE], char color) {
+	const char* p = &board[0][0];
+	unsigned long long mask = 0;
+#if defined(SCAN_AVX2)
+	__m256i x, black;
+	for (int i=0 ; i<2 ; i++) {
+		x = _mm256_loadu_si256((const __m256i*)(p+32*i));
+		black = _mm256_cmpgt_epi8(x, _mm256_set1_epi8(BLACK_PIECE));
+		x = color==WHITE? _mm256_andnot_si256(black, _mm256_cmpgt_epi8(x, _mm256_set1_epi8(EMPTY))) : black;
+		mask |= (unsigned long long)(unsigned)_mm256_movemask_epi8(x) << (32*i);
+	}
+#elif defined(SCAN_SSE2)
+	__m128i x, black;
+	for (int i=0 ; i<4 ; i++) {
+		x = _mm_loadu_si128((const __m128i*)(p+16*i));
+		black = _mm_cmpgt_epi8(x, _mm_set1_epi8(BLACK_PIECE));
+		x = color==WHITE? _mm_andnot_si128(black, _mm_cmpgt_epi8(x, _mm_set1_epi8(EMPTY))) : black;
+		mask |= (unsigned long long)(unsigned)_mm_movemask_epi8(x) << (16*i);
+	}
+#else
+	for (int i=0 ; i<BOARD_SIZE*BOARD_SIZE ; i++)
+		if (color==WHITE? (p[i]>EMPTY && p[i]<BLACK_PIECE) : p[i]>BLACK_PIECE)
+			mask |= 1ULL << i;
+#endif
+	return mask;
+}
+
+/* number of squares in mask */
+int popCount(unsigned long long mask) {
+#if defined(__GNUC__)
+	return __builtin_popcountll(mask);
+#else
+	int n;
+	for (n=0 ; mask ; n++)
+		mask &= mask-1;
+	return n;
+#endif
+}
+
+/* lowest square in mask
+ * @pre: mask != 0 */
+int firstSquare(unsigned long long mask) {
+#if defined(__GNUC__)
+	return __builtin_ctzll(mask);
+#else
+	int i;
+	for (i=0 ; !(mask & 1) ; i++)
+		mask >>= 1;
+	return i;
+#endif
+}
+
+/* highest square in mask
+ * @pre: mask != 0 */
+int lastSquare(unsigned long long mask) {
+#if defined(__GNUC__)
+	return 63-__builtin_clzll(mask);
+#else
+	int i;
+	for (i=-1 ; mask ; i++)
+		mask >>= 1;
+	return i;
+#endif
+}
@@ -0,0 +1,23 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 scan.h                                       */
+/* contents: whole board scans                            */
+/**********************************************************/
+#include "chessprog.h"
+#ifndef SCAN_H_
+#define SCAN_H_
+
+/* A scan returns a 64 bit mask of squares, bit col*BOARD_SIZE+row for board[col][row] (the board's
+ * memory order, same as the square index of position.h). SSE2 or AVX2 kernels are used when built
+ * for them (see SIMD_FLAGS in makefile), plain loops otherwise or with -DSCAN_SCALAR. */
+
+unsigned long long scanPiece(char board[BOARD_SIZE][BOARD_SIZE], char piece);
+unsigned long long scanColor(char board[BOARD_SIZE][BOARD_SIZE], char color);
+int popCount(unsigned long long mask);
+int firstSquare(unsigned long long mask);
+int lastSquare(unsigned long long mask);
+
+#endif /* SCAN_H_ */
@@ -0,0 +1,205 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 scanbench.c                                  */
+/* contents: microbenchmark of scan.c against board loops */
+/**********************************************************/
+#include "scan.h"
+
+#define BENCH_ITERATIONS 1000000
+
+static volatile unsigned sink; /*keeps results alive*/
+
+/******************* board loops: the one getKingPos replaced, those countPieces and getPieceSquares kept ************************/
+
+static const char pieces[12] = {W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING, \
+		B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING};
+
+/* countPieces kept this switch, the scans below are no faster */
+static void loopCountPieces(char board[BOARD_SIZE][BOARD_SIZE], unsigned answer[12]){
+	unsigned i, j, m = 0, n = 0, b = 0, r = 0, q = 0, k = 0, M = 0, N = 0, B = 0, R = 0, Q = 0, K = 0;
+	char c = ' ';
+
+	for (i = 0; i < BOARD_SIZE; i++){
+		for (j = 0; j < BOARD_SIZE; j++){
+			c = board[i][j];
+			switch (c) {
+			case W_PAWN:
+				m++;
+				break;
+			case W_KNIGHT:
+				n++;
+				break;
+			case W_BISHOP:
+				b++;
+				break;
+			case W_ROOK:
+				r++;
+				break;
+			case W_QUEEN:
+				q++;
+				break;
+			case W_KING:
+				k++;
+				break;
+			case B_PAWN:
+				M++;
+				break;
+			case B_KNIGHT:
+				N++;
+				break;
+			case B_BISHOP:
+				B++;
+				break;
+			case B_ROOK:
+				R++;
+				break;
+			case B_QUEEN:
+				Q++;
+				break;
+			case B_KING:
+				K++;
+				break;
+
+			}
+		}
+	}
+	answer[0] = m;
+	answer[1] = n;
+	answer[2] = b;
+	answer[3] = r;
+	answer[4] = q;
+	answer[5] = k;
+	answer[6] = M;
+	answer[7] = N;
+	answer[8] = B;
+	answer[9] = R;
+	answer[10] = Q;
+	answer[11] = K;
+}
+
+static pos_t loopKingPos(char board[BOARD_SIZE][BOARD_SIZE], char king) {
+	pos_t p;
+	for (p.col=0 ; p.col<BOARD_SIZE ; p.col++)
+		for (p.row=0 ; p.row<BOARD_SIZE ; p.row++)
+			if (board[p.col][p.row]==king)
+				return p;
+	return p;
+}
+
+/* kept by getPieceSquares, the scans below are no faster */
+static unsigned loopPieceSquares(char board[BOARD_SIZE][BOARD_SIZE], char color, unsigned char squares[64]) {
+	unsigned n = 0;
+	for (int i=0 ; i<BOARD_SIZE ; i++)
+		for (int j=0 ; j<BOARD_SIZE ; j++) {
+			if (board[i][j] == EMPTY || color != getColor(board[i][j]))
+				continue;
+			if (pieceType(board[i][j]) == KING) { /*king first*/
+				memmove(squares+1, squares, n);
+				squares[0] = i*BOARD_SIZE+j;
+			}
+			else
+				squares[n] = i*BOARD_SIZE+j;
+			n++;
+		}
+	return n;
+}
+
+/******************* same jobs with scans ************************/
+
+static void scanCountPieces(char board[BOARD_SIZE][BOARD_SIZE], unsigned answer[12]) {
+	for (int k=0 ; k<12 ; k++)
+		answer[k] = popCount(scanPiece(board, pieces[k]));
+}
+
+static pos_t scanKingPos(char board[BOARD_SIZE][BOARD_SIZE], char king) {
+	pos_t p;
+	int square = firstSquare(scanPiece(board, king));
+	p.col = square/BOARD_SIZE;
+	p.row = square%BOARD_SIZE;
+	return p;
+}
+
+static unsigned scanPieceSquares(char board[BOARD_SIZE][BOARD_SIZE], char color, unsigned char squares[64]) {
+	unsigned long long kings = scanPiece(board, color==WHITE? W_KING:B_KING);
+	unsigned n = 0;
+	for (unsigned long long pieces=kings ; pieces ; pieces &= pieces-1)
+		squares[n++] = firstSquare(pieces);
+	for (unsigned long long pieces=scanColor(board, color)&~kings ; pieces ; pieces &= pieces-1)
+		squares[n++] = firstSquare(pieces);
+	return n;
+}
+
+/******************* benchmark ************************/
+
+/* board from rows of letters, in the order of pieces (no pieceInfo, scanbench isn't linked with chessprog.o) */
+static void setBoard(char board[BOARD_SIZE][BOARD_SIZE], const char* rows[BOARD_SIZE]) {
+	const char* letters = "mnbrqkMNBRQK";
+	for (int row=0 ; row<BOARD_SIZE ; row++) /*rows[0] is row 8*/
+		for (int col=0 ; col<BOARD_SIZE ; col++)
+			board[col][BOARD_SIZE-1-row] = rows[row][col]=='.'? EMPTY: \
+					pieces[strchr(letters, rows[row][col])-letters];
+}
+
+static double nsPerCall(clock_t start) {
+	return 1e9*(clock()-start)/CLOCKS_PER_SEC/BENCH_ITERATIONS;
+}
+
+static int bench(const char* name, char board[BOARD_SIZE][BOARD_SIZE]) {
+	unsigned a[12], b[12], n, m;
+	unsigned char sa[64], sb[64];
+	pos_t pa, pb;
+	clock_t start;
+	int ok = 1;
+
+	loopCountPieces(board, a);
+	scanCountPieces(board, b);
+	pa = loopKingPos(board, B_KING);
+	pb = scanKingPos(board, B_KING);
+	n = loopPieceSquares(board, BLACK, sa);
+	m = scanPieceSquares(board, BLACK, sb);
+	if (memcmp(a, b, sizeof(a)) || pa.col!=pb.col || pa.row!=pb.row || n!=m || memcmp(sa, sb, n)) {
+		printf("%s: scan results differ from the loops\n", name);
+		ok = 0;
+	}
+
+	printf("%s\n", name);
+	start = clock();
+	for (int i=0 ; i<BENCH_ITERATIONS ; i++) { loopCountPieces(board, a); sink += a[i%12]; }
+	printf("  countPieces     loop %7.1f ns", nsPerCall(start));
+	start = clock();
+	for (int i=0 ; i<BENCH_ITERATIONS ; i++) { scanCountPieces(board, a); sink += a[i%12]; }
+	printf("   scan %7.1f ns\n", nsPerCall(start));
+
+	start = clock();
+	for (int i=0 ; i<BENCH_ITERATIONS ; i++) sink += loopKingPos(board, i&1? W_KING:B_KING).row;
+	printf("  getKingPos      loop %7.1f ns", nsPerCall(start));
+	start = clock();
+	for (int i=0 ; i<BENCH_ITERATIONS ; i++) sink += scanKingPos(board, i&1? W_KING:B_KING).row;
+	printf("   scan %7.1f ns\n", nsPerCall(start));
+
+	start = clock();
+	for (int i=0 ; i<BENCH_ITERATIONS ; i++) sink += loopPieceSquares(board, i&1? WHITE:BLACK, sa);
+	printf("  piece discovery loop %7.1f ns", nsPerCall(start));
+	start = clock();
+	for (int i=0 ; i<BENCH_ITERATIONS ; i++) sink += scanPieceSquares(board, i&1? WHITE:BLACK, sa);
+	printf("   scan %7.1f ns\n", nsPerCall(start));
+	return ok;
+}
+
+int main() {
+	char board[BOARD_SIZE][BOARD_SIZE];
+	const char* opening[BOARD_SIZE] = {"RNBQKBNR", "MMMMMMMM", "........", "........",
+			"........", "........", "mmmmmmmm", "rnbqkbnr"};
+	const char* endgame[BOARD_SIZE] = {"......K.", ".....MM.", "........", "...m....",
+			"........", "......r.", ".....mmm", "......k."};
+	int ok;
+
+	setBoard(board, opening);
+	ok = bench("opening", board);
+	setBoard(board, endgame);
+	ok = bench("endgame", board) && ok;
+	return ok? 0:1;
+}
@@ -0,0 +1,632 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 tablebase.c                                  */
+/* contents: endgame tablebases                           */
+/**********************************************************/
+#include "tablebase.h"
+#include "attack.h"
+#include "scan.h"
+#include "tables.h"
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TB_SQUARES (BOARD_SIZE*BOARD_SIZE)
+#define TB_MAX_TABLES 64 /*more than all tables of TB_MAX_PIECES pieces*/
+#define TB_MAX_MOVES 128
+#define TB_PATH 256
+#define TB_UNKNOWN TB_DRAW /*value of a position the generator hasn't resolved (yet)*/
+#define TB_CANNOT_LOSE 0xFF /*count of a position with a move out of the table to a draw or a win*/
+
+/*the generator's threads share counters and values, so they need atomic updates*/
+#if defined(__GNUC__)
+#define atomicDec(P) __sync_sub_and_fetch(P, 1)
+#define atomicSet(P, OLD, NEW) __sync_bool_compare_and_swap(P, OLD, NEW)
+#define GEN_THREADS TB_THREADS
+#else
+#define atomicDec(P) (--*(P))
+#define atomicSet(P, OLD, NEW) (*(P)==(OLD)? (*(P)=(NEW), 1):0)
+#define GEN_THREADS 1
+#endif
+
+typedef struct { /*an open table*/
+	char name[TB_MAX_PIECES+1];
+	int n; /*pieces*/
+	char pieces[TB_MAX_PIECES]; /*by slot, in the order of the name's letters*/
+	unsigned long long size; /*positions, 2*64^n*/
+	const unsigned char* values;
+	void* mapping;
+	size_t mappingSize;
+} tbTable_t;
+
+typedef struct { /*a position of a table's pieces*/
+	int n;
+	char pieces[TB_MAX_PIECES];
+	int squares[TB_MAX_PIECES];
+	int side; /*to move, 0 for white*/
+} tbPos_t;
+
+typedef struct { /*a generator thread's share of a table*/
+	tbTable_t* table;
+	unsigned char *values, *count, *pending; /*see generateTable*/
+	unsigned long long first, last; /*positions of the share*/
+	int pass;
+	unsigned long assigned; /*values set by the thread in its last run*/
+	int maxPending;
+	int error;
+} tbJob_t;
+
+/*open tables, mapped by tbOpen and tbGenerate before any search and only read afterwards*/
+static tbTable_t tables[TB_MAX_TABLES];
+static int tableCount = 0;
+
+static const char tbLetters[] = "KQRBNP"; /*order of the letters of a side in a table name*/
+static const char tbTypes[] = {KING, QUEEN, ROOK, BISHOP, KNIGHT, PAWN};
+
+/******************* positions ************************/
+
+/* rank of letter in tbLetters, -1 if it isn't a piece letter */
+static int letterRank(char letter) {
+	const char* p = strchr(tbLetters, letter);
+	return letter!='\0' && p!=NULL? p-tbLetters : -1;
+}
+
+/* name of the table of pos's pieces
+ * @post: return 1 if the table has the colors swapped (black is the stronger side), 0 otherwise */
+static int tableName(const tbPos_t* pos, char name[TB_MAX_PIECES+1]) {
+	char sides[2][TB_MAX_PIECES+1];
+	int len[2] = {0, 0}, side, swap, i;
+
+	for (int rank=0 ; rank<6 ; rank++)
+		for (i=0 ; i<pos->n ; i++)
+			if (pieceType(pos->pieces[i]) == tbTypes[rank]) {
+				side = pieceSide(pos->pieces[i]);
+				sides[side][len[side]++] = tbLetters[rank];
+			}
+	sides[0][len[0]] = sides[1][len[1]] = '\0';
+	for (i=0 ; i<len[0] && i<len[1] && sides[0][i]==sides[1][i] ; i++);
+	swap = len[1]>len[0] || (len[1]==len[0] && i<len[0] && letterRank(sides[1][i])<letterRank(sides[0][i]));
+	strcpy(name, sides[swap]);
+	strcat(name, sides[1-swap]);
+	return swap;
+}
+
+/* pieces of the table called name, white first
+ * @post: return the number of pieces, -1 if name isn't a table of a king and up to TB_MAX_PIECES-1 pieces per side */
+static int tablePieces(const char* name, char pieces[TB_MAX_PIECES]) {
+	int n = 0, kings = 0;
+
+	if (name[0] != 'K')
+		return -1;
+	for (; *name != '\0' ; name++) {
+		if (letterRank(*name) == -1 || n == TB_MAX_PIECES)
+			return -1;
+		kings += *name == 'K';
+		pieces[n++] = (kings==2? BLACK_PIECE:0) | tbTypes[letterRank(*name)];
+	}
+	return kings==2 && n>2? n:-1;
+}
+
+static unsigned long long tbIndex(const tbPos_t* pos) {
+	unsigned long long index = pos->side;
+	for (int i=0 ; i<pos->n ; i++)
+		index = index*TB_SQUARES + pos->squares[i];
+	return index;
+}
+
+static void tbDecode(const tbTable_t* table, unsigned long long index, tbPos_t* pos) {
+	pos->n = table->n;
+	for (int i=table->n-1 ; i>=0 ; i--) {
+		pos->pieces[i] = table->pieces[i];
+		pos->squares[i] = index % TB_SQUARES;
+		index /= TB_SQUARES;
+	}
+	pos->side = index;
+}
+
+/* squares of pos's pieces of side, both sides for side -1 */
+static unsigned long long occupancy(const tbPos_t* pos, int side) {
+	unsigned long long mask = 0;
+	for (int i=0 ; i<pos->n ; i++)
+		if (side == -1 || pieceSide(pos->pieces[i]) == side)
+			mask |= squareBit(pos->squares[i]);
+	return mask;
+}
+
+/* squares piece on square attacks, sliders stop at the first occupied square */
+static unsigned long long pieceAttacks(char piece, int square, unsigned long long occupied) {
+	unsigned long long mask = 0, ray, blockers;
+
+	switch (pieceType(piece)) {
+	case PAWN:
+		return pawnAttacks[pieceSide(piece)][square];
+	case KNIGHT:
+		return knightAttacks[square];
+	case KING:
+		return kingAttacks[square];
+	}
+	for (int d=pieceAttr(piece).firstStep ; d<pieceAttr(piece).lastStep ; d++) {
+		ray = rays[d][square];
+		if ((blockers = ray & occupied) != 0)
+			ray &= ~rays[d][rayStep(d)>0? firstSquare(blockers) : lastSquare(blockers)];
+		mask |= ray;
+	}
+	return mask;
+}
+
+/* true iff the king of side is attacked in pos */
+static int kingAttacked(const tbPos_t* pos, int side) {
+	unsigned long long occupied = occupancy(pos, -1), king = 0;
+
+	for (int i=0 ; i<pos->n ; i++)
+		if (pos->pieces[i] == (side? B_KING:W_KING))
+			king = squareBit(pos->squares[i]);
+	for (int i=0 ; i<pos->n ; i++)
+		if (pieceSide(pos->pieces[i]) != side && (pieceAttacks(pos->pieces[i], pos->squares[i], occupied) & king))
+			return 1;
+	return 0;
+}
+
+/* true iff pos can come up in a game, see TB_ILLEGAL */
+static int isLegalPos(const tbPos_t* pos) {
+	unsigned long long seen = 0;
+
+	for (int i=0 ; i<pos->n ; i++) {
+		if (seen & squareBit(pos->squares[i]))
+			return 0;
+		seen |= squareBit(pos->squares[i]);
+		if (pieceType(pos->pieces[i])==PAWN && (squareRow(pos->squares[i])==0 || squareRow(pos->squares[i])==BOARD_SIZE-1))
+			return 0;
+	}
+	return !kingAttacked(pos, 1-pos->side);
+}
+
+/* add the position after the piece of slot moves to square to children, if it doesn't leave its king attacked
+ * @post: return 1 if it was added */
+static int addChild(const tbPos_t* pos, int slot, int square, char promotion, tbPos_t* children, int* inside) {
+	tbPos_t* child = children;
+	int captured = -1;
+
+	*child = *pos;
+	for (int i=0 ; i<pos->n ; i++)
+		if (pos->squares[i]==square)
+			captured = i;
+	child->squares[slot] = square;
+	if (promotion != EMPTY)
+		child->pieces[slot] = promotion;
+	if (captured != -1) {
+		for (int i=captured ; i<pos->n-1 ; i++) {
+			child->pieces[i] = child->pieces[i+1];
+			child->squares[i] = child->squares[i+1];
+		}
+		child->n--;
+	}
+	child->side = 1-pos->side;
+	*inside = captured==-1 && promotion==EMPTY;
+	return !kingAttacked(child, pos->side);
+}
+
+/* fill children with the positions after each legal move of pos's side to move, inside[i] is set for those
+ * with the same pieces (no capture or promotion)
+ * @pre: pos is legal
+ * @post: return the number of children */
+static int tbMoves(const tbPos_t* pos, tbPos_t children[TB_MAX_MOVES], int inside[TB_MAX_MOVES]) {
+	unsigned long long occupied = occupancy(pos, -1), own = occupancy(pos, pos->side), targets;
+	int n = 0, square, row, dir = pos->side==0? 1:-1;
+
+	for (int i=0 ; i<pos->n ; i++) {
+		if (pieceSide(pos->pieces[i]) != pos->side)
+			continue;
+		if (pieceType(pos->pieces[i]) == PAWN) {
+			square = pos->squares[i];
+			targets = pawnAttacks[pos->side][square] & occupied & ~own;
+			if (!(occupied & squareBit(square+dir))) /*one row forward, see toSquare*/
+				targets |= squareBit(square+dir);
+		}
+		else
+			targets = pieceAttacks(pos->pieces[i], pos->squares[i], occupied) & ~own;
+		for (; targets ; targets &= targets-1) {
+			square = firstSquare(targets);
+			row = squareRow(square);
+			if (pieceType(pos->pieces[i])==PAWN && (row==0 || row==BOARD_SIZE-1)) { /*queen, rook, bishop and knight*/
+				for (int t=QUEEN ; t>=KNIGHT ; t--)
+					n += addChild(pos, i, square, (pos->pieces[i]&BLACK_PIECE)|t, children+n, inside+n);
+			}
+			else
+				n += addChild(pos, i, square, EMPTY, children+n, inside+n);
+		}
+	}
+	return n;
+}
+
+/* fill parents with the legal positions whose side to move has a move to pos that keeps the pieces
+ * @post: return the number of parents */
+static int tbUnmoves(const tbPos_t* pos, tbPos_t parents[TB_MAX_MOVES]) {
+	unsigned long long occupied = occupancy(pos, -1), sources;
+	int n = 0, mover = 1-pos->side, square, row;
+
+	for (int i=0 ; i<pos->n ; i++) {
+		if (pieceSide(pos->pieces[i]) != mover)
+			continue;
+		square = pos->squares[i];
+		if (pieceType(pos->pieces[i]) == PAWN) { /*a single step back, not onto the first row*/
+			row = squareRow(square) - (mover==0? 1:-1);
+			sources = row>0 && row<BOARD_SIZE-1? squareBit(toSquare(squareCol(square), row)) & ~occupied : 0;
+		}
+		else /*moves are their own way back*/
+			sources = pieceAttacks(pos->pieces[i], square, occupied) & ~occupied;
+		for (; sources ; sources &= sources-1) {
+			parents[n] = *pos;
+			parents[n].squares[i] = firstSquare(sources);
+			parents[n].side = mover;
+			n += !kingAttacked(&parents[n], pos->side);
+		}
+	}
+	return n;
+}
+
+/******************* tables ************************/
+
+static tbTable_t* findTable(const char* name) {
+	for (int i=0 ; i<tableCount ; i++)
+		if (strcmp(tables[i].name, name) == 0)
+			return &tables[i];
+	return NULL;
+}
+
+/* value of pos, TB_DRAW for bare kings
+ * @post: return TB_NONE if pos's table isn't open */
+static int lookup(const tbPos_t* pos) {
+	char name[TB_MAX_PIECES+1];
+	int swap, used = 0, square;
+	tbTable_t* table;
+	tbPos_t key;
+
+	if (pos->n == 2)
+		return TB_DRAW;
+	swap = tableName(pos, name);
+	if ((table = findTable(name)) == NULL)
+		return TB_NONE;
+	key.n = table->n;
+	key.side = swap? 1-pos->side : pos->side;
+	for (int j=0 ; j<table->n ; j++) { /*first unused piece of the slot's kind*/
+		for (int i=0 ; i<pos->n ; i++) {
+			if ((used & (1<<i)) || (pos->pieces[i] ^ (swap? BLACK_PIECE:0)) != table->pieces[j])
+				continue;
+			square = pos->squares[i];
+			key.squares[j] = swap? toSquare(squareCol(square), BOARD_SIZE-1-squareRow(square)) : square;
+			key.pieces[j] = table->pieces[j];
+			used |= 1<<i;
+			break;
+		}
+	}
+	return table->values[tbIndex(&key)];
+}
+
+/* path of the file of table name in dir */
+static void tablePath(const char* dir, const char* name, char path[TB_PATH]) {
+	snprintf(path, TB_PATH, "%s/%s.tb", dir, name);
+}
+
+/* map the file of table name in dir
+ * @post: return 0 on success (or if it's open already), -1 if the file is missing or isn't a table of this version */
+static int openTable(const char* dir, const char* name) {
+	char path[TB_PATH];
+	const tbHeader_t* header;
+	tbTable_t* table = &tables[tableCount];
+	struct stat st;
+	void* map;
+	int fd;
+
+	if (findTable(name) != NULL)
+		return 0;
+	if (tableCount == TB_MAX_TABLES || (table->n = tablePieces(name, table->pieces)) == -1)
+		return -1;
+	table->size = 2;
+	for (int i=0 ; i<table->n ; i++)
+		table->size *= TB_SQUARES;
+	tablePath(dir, name, path);
+	if ((fd = open(path, O_RDONLY)) == -1)
+		return -1;
+	if (fstat(fd, &st) == -1 || (size_t)st.st_size != sizeof(tbHeader_t)+table->size) {
+		close(fd);
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); /*the mapping stays valid*/
+	if (map == MAP_FAILED)
+		return -1;
+	header = (const tbHeader_t*)map;
+	if (strncmp(header->magic, TB_MAGIC, sizeof(header->magic)) != 0 || header->version != TB_VERSION || \
+			strncmp(header->name, name, sizeof(header->name)) != 0 || header->size != table->size) {
+		munmap(map, st.st_size);
+		return -1;
+	}
+	strcpy(table->name, name);
+	table->values = (const unsigned char*)(header+1);
+	table->mapping = map;
+	table->mappingSize = st.st_size;
+	tableCount++;
+	return 0;
+}
+
+/* map all tables found in dir
+ * @post: return the number of open tables */
+int tbOpen(const char* dir) {
+	tbPos_t pos;
+	char name[TB_MAX_PIECES+1];
+
+	pos.pieces[0] = W_KING;
+	pos.pieces[1] = B_KING;
+	for (int a=0 ; a<=2*6 ; a++) /*up to two more pieces of either color, 0 for none*/
+		for (int b=a ; b<=2*6 ; b++) {
+			pos.n = 2;
+			if (a != 0)
+				pos.pieces[pos.n++] = (a>6? BLACK_PIECE:0) | tbTypes[(a-1)%6];
+			if (b != 0)
+				pos.pieces[pos.n++] = (b>6? BLACK_PIECE:0) | tbTypes[(b-1)%6];
+			if (pos.n>2 && pos.n<=TB_MAX_PIECES && pieceType(pos.pieces[pos.n-1])!=KING && pieceType(pos.pieces[2])!=KING) {
+				tableName(&pos, name);
+				openTable(dir, name);
+			}
+		}
+	return tableCount;
+}
+
+/* unmap all tables */
+void tbClose() {
+	for (int i=0 ; i<tableCount ; i++)
+		munmap(tables[i].mapping, tables[i].mappingSize);
+	tableCount = 0;
+}
+
+/* true iff color may still castle on board */
+static int canCastle(char board[BOARD_SIZE][BOARD_SIZE], char color) {
+	int row = color==WHITE? 0:BOARD_SIZE-1;
+	char rook = color==WHITE? W_ROOK:B_ROOK;
+	if ((color==WHITE? wk:bk) || board[4][row] != (color==WHITE? W_KING:B_KING))
+		return 0;
+	return (!(color==WHITE? wlr:blr) && board[0][row]==rook) || (!(color==WHITE? wrr:brr) && board[7][row]==rook);
+}
+
+/* value of board with color to move (see tablebase.h)
+ * @post: return TB_NONE if its pieces have no open table, or a side may still castle */
+int tbProbe(char board[BOARD_SIZE][BOARD_SIZE], char color) {
+	tbPos_t pos;
+	int square, value;
+
+	if (tableCount == 0)
+		return TB_NONE;
+	pos.n = 0;
+	for (unsigned long long pieces=scanColor(board, WHITE)|scanColor(board, BLACK) ; pieces ; pieces &= pieces-1) {
+		if (pos.n == TB_MAX_PIECES)
+			return TB_NONE;
+		square = firstSquare(pieces);
+		pos.pieces[pos.n] = board[squareCol(square)][squareRow(square)];
+		pos.squares[pos.n++] = square;
+	}
+	if (canCastle(board, WHITE) || canCastle(board, BLACK))
+		return TB_NONE;
+	pos.side = colorSide(color);
+	value = lookup(&pos);
+	return value==TB_ILLEGAL? TB_NONE : value;
+}
+
+/******************* generator ************************/
+
+/* thread: find the moves of each position of job's share
+ * count: moves to positions of the table, or TB_CANNOT_LOSE if a move leaves the table for a draw or a win
+ * pending: plies of the quickest win out of the table (if count is TB_CANNOT_LOSE), or of the slowest loss */
+static void* initShare(void* arg) {
+	tbJob_t* job = (tbJob_t*)arg;
+	tbPos_t pos, children[TB_MAX_MOVES];
+	int inside[TB_MAX_MOVES], n, count, value, win, loss, draw;
+
+	for (unsigned long long index=job->first ; index<job->last ; index++) {
+		tbDecode(job->table, index, &pos);
+		job->count[index] = 0;
+		job->pending[index] = 0;
+		if (!isLegalPos(&pos)) {
+			job->values[index] = TB_ILLEGAL;
+			continue;
+		}
+		if ((n = tbMoves(&pos, children, inside)) == 0) { /*mate or tie*/
+			job->values[index] = kingAttacked(&pos, pos.side)? 1:TB_DRAW;
+			job->count[index] = TB_CANNOT_LOSE;
+			continue;
+		}
+		count = win = loss = draw = 0;
+		for (int i=0 ; i<n ; i++) {
+			if (inside[i]) {
+				count++;
+				continue;
+			}
+			if ((value = lookup(&children[i])) == TB_NONE) {
+				job->error = 1;
+				return NULL;
+			}
+			if (value == TB_DRAW)
+				draw = 1;
+			else if (!tbWins(value)) /*opponent is mated*/
+				win = win==0 || tbPlies(value)+1<win? tbPlies(value)+1 : win;
+			else
+				loss = tbPlies(value)+1>loss? tbPlies(value)+1 : loss;
+		}
+		job->count[index] = win || draw? TB_CANNOT_LOSE : count;
+		job->pending[index] = win || draw? win : loss;
+		job->maxPending = job->pending[index]>job->maxPending? job->pending[index] : job->maxPending;
+	}
+	return NULL;
+}
+
+/* thread: set the values that job's pass reached by moves out of the table */
+static void* settleShare(void* arg) {
+	tbJob_t* job = (tbJob_t*)arg;
+
+	job->assigned = 0;
+	for (unsigned long long index=job->first ; index<job->last ; index++)
+		if (job->values[index]==TB_UNKNOWN && job->pending[index]==job->pass && \
+				(job->count[index]==0 || job->count[index]==TB_CANNOT_LOSE)) {
+			job->values[index] = job->pass+1;
+			job->assigned++;
+		}
+	return NULL;
+}
+
+/* thread: pass the values of plies job->pass in job's share on to the positions before them */
+static void* retreatShare(void* arg) {
+	tbJob_t* job = (tbJob_t*)arg;
+	tbPos_t pos, parents[TB_MAX_MOVES];
+	unsigned long long parent;
+	int n, pass = job->pass;
+
+	job->assigned = 0;
+	for (unsigned long long index=job->first ; index<job->last ; index++) {
+		if (job->values[index] != pass+1)
+			continue;
+		tbDecode(job->table, index, &pos);
+		n = tbUnmoves(&pos, parents);
+		for (int i=0 ; i<n ; i++) {
+			parent = tbIndex(&parents[i]);
+			if (pass%2 == 0) /*side to move is mated, the parent mates a ply earlier*/
+				job->assigned += atomicSet(&job->values[parent], TB_UNKNOWN, pass+2);
+			else if (job->count[parent] != TB_CANNOT_LOSE && atomicDec(&job->count[parent]) == 0 && \
+					job->pending[parent] <= pass+1) /*every move of the parent mates it, this one last*/
+				job->assigned += atomicSet(&job->values[parent], TB_UNKNOWN, pass+2);
+		}
+	}
+	return NULL;
+}
+
+/* run work on each job in a thread of its own
+ * @post: return -1 if a thread can't be started */
+static int runJobs(tbJob_t jobs[GEN_THREADS], void* (*work)(void*)) {
+	pthread_t threads[GEN_THREADS];
+	int started, result = 0;
+
+	for (started=0 ; started<GEN_THREADS ; started++)
+		if (pthread_create(&threads[started], NULL, work, &jobs[started]) != 0) {
+			result = -1;
+			break;
+		}
+	for (int i=0 ; i<started ; i++)
+		pthread_join(threads[i], NULL);
+	return result;
+}
+
+/* generate the values of table (already has name, pieces and size) and write it to its file in dir
+ * @pre: the tables its captures and promotions lead to are open
+ * @post: return 0 on success, -1 on allocation or file error */
+static int generateTable(const char* dir, tbTable_t* table) {
+	tbJob_t jobs[GEN_THREADS];
+	unsigned char *values = malloc(table->size), *count = malloc(table->size), *pending = malloc(table->size);
+	unsigned long assigned;
+	int maxPending = 0, error = 0, pass;
+	char path[TB_PATH];
+	tbHeader_t header;
+	FILE* fp;
+
+	if (values==NULL || count==NULL || pending==NULL) {
+		free(values);
+		free(count);
+		free(pending);
+		return -1; /*allocation error*/
+	}
+	memset(values, TB_UNKNOWN, table->size);
+	for (int i=0 ; i<GEN_THREADS ; i++) {
+		jobs[i].table = table;
+		jobs[i].values = values;
+		jobs[i].count = count;
+		jobs[i].pending = pending;
+		jobs[i].first = table->size/GEN_THREADS*i;
+		jobs[i].last = i==GEN_THREADS-1? table->size : table->size/GEN_THREADS*(i+1);
+		jobs[i].maxPending = 0;
+		jobs[i].error = 0;
+	}
+	error = runJobs(jobs, initShare);
+	for (int i=0 ; i<GEN_THREADS ; i++) {
+		error = error || jobs[i].error;
+		maxPending = jobs[i].maxPending>maxPending? jobs[i].maxPending : maxPending;
+	}
+
+	/*pass: positions with plies to mate pass get their values, then those a ply before them*/
+	for (pass=0 ; !error && pass<TB_ILLEGAL-2 ; pass++) {
+		for (int i=0 ; i<GEN_THREADS ; i++)
+			jobs[i].pass = pass;
+		error = pass>0 && runJobs(jobs, settleShare);
+		error = error || runJobs(jobs, retreatShare);
+		assigned = 0;
+		for (int i=0 ; i<GEN_THREADS ; i++)
+			assigned += jobs[i].assigned;
+		if (assigned == 0 && pass >= maxPending)
+			break;
+	}
+	error = error || pass==TB_ILLEGAL-2; /*too long for a value*/
+
+	free(count);
+	free(pending);
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TB_MAGIC, sizeof(header.magic)); /*no terminating zero*/
+	header.version = TB_VERSION;
+	strncpy(header.name, table->name, sizeof(header.name));
+	header.size = table->size;
+	tablePath(dir, table->name, path);
+	if (!error && (fp = fopen(path, "wb")) != NULL) {
+		error = fwrite(&header, sizeof(header), 1, fp) != 1 || fwrite(values, 1, table->size, fp) != table->size;
+		error = fclose(fp) != 0 || error;
+	}
+	else
+		error = 1;
+	free(values);
+	return error? -1:0;
+}
+
+/* generate table name (any color order) into dir, and first the tables its captures and promotions lead to.
+ * Tables found in dir aren't generated again.
+ * @post: return 0 on success, -1 for a bad name, or on allocation or file error */
+int tbGenerate(const char* dir, const char* name) {
+	char canonical[TB_MAX_PIECES+1], sub[TB_MAX_PIECES+1];
+	tbTable_t* table;
+	tbPos_t pos, next;
+
+	if ((pos.n = tablePieces(name, pos.pieces)) == -1)
+		return -1;
+	tableName(&pos, canonical);
+	if (openTable(dir, canonical) == 0)
+		return 0;
+	for (int i=0 ; i<pos.n ; i++) { /*captures of each piece but the kings, and promotions of each pawn*/
+		for (int t=0 ; t<6 ; t++) {
+			next = pos;
+			if (t == 0 && pieceType(pos.pieces[i]) != KING) {
+				for (int j=i ; j<pos.n-1 ; j++)
+					next.pieces[j] = pos.pieces[j+1];
+				next.n--;
+			}
+			else if (t>0 && t<5 && pieceType(pos.pieces[i]) == PAWN)
+				next.pieces[i] = (pos.pieces[i]&BLACK_PIECE) | tbTypes[t];
+			else
+				continue;
+			tableName(&next, sub);
+			if (next.n > 2 && tbGenerate(dir, sub) == -1)
+				return -1;
+		}
+	}
+
+	if (tableCount == TB_MAX_TABLES)
+		return -1;
+	mkdir(dir, 0755); /*may exist already*/
+	table = &tables[tableCount];
+	strcpy(table->name, canonical);
+	table->n = tablePieces(canonical, table->pieces);
+	table->size = 2;
+	for (int i=0 ; i<table->n ; i++)
+		table->size *= TB_SQUARES;
+	if (generateTable(dir, table) == -1)
+		return -1;
+	return openTable(dir, canonical);
+}
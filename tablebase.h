@@ -0,0 +1,50 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 tablebase.h                                  */
+/* contents: endgame tablebases                           */
+/**********************************************************/
+#include "chessprog.h"
+#ifndef TABLEBASE_H_
+#define TABLEBASE_H_
+
+/* A table holds, for every placement of its pieces (kings included, TB_MAX_PIECES at most) and side to move,
+ * the plies to mate with best play under this project's rules: pawns step a single square, there's no en
+ * passant and a side without moves that isn't in check ties. Tables are named by their pieces, the stronger
+ * side first: "KQK", "KBNK", "KRKP". The same pieces with the colors swapped are looked up in the table with
+ * the board mirrored. Castling isn't in the tables, boards a side may still castle on aren't probed.
+ *
+ * "chessprog tablebase <name>..." generates tables into TB_DIR, with the ones their captures and promotions
+ * lead to, and main maps all tables found there (see tbOpen).
+ *
+ * Table file, native byte order:
+ *   tbHeader_t, then unsigned char values[2*64^n] by side to move (white first) and piece squares, in the
+ *   order of the name's letters (see toSquare).
+ * A value is TB_DRAW, TB_ILLEGAL, or plies to mate + 1: odd if the side to move is mated, even if it mates. */
+
+#define TB_MAGIC "CNTB"
+#define TB_VERSION 1
+#define TB_DIR "tablebases"
+#define TB_MAX_PIECES 4
+#define TB_THREADS 4 /*threads of the generator*/
+#define TB_DRAW 0
+#define TB_ILLEGAL 255 /*two pieces on a square, a pawn on the first or last row, or the side not to move in check*/
+#define TB_NONE -1 /*tbProbe of a board that isn't in an open table*/
+#define tbPlies(V) ((V)-1)
+#define tbWins(V) ((V)%2 == 0) /*side to move mates, for values other than TB_DRAW*/
+
+typedef struct {
+	char magic[4]; /*TB_MAGIC*/
+	unsigned version;
+	char name[8]; /*zero padded*/
+	unsigned long long size; /*values following the header*/
+} tbHeader_t;
+
+int tbOpen(const char* dir);
+void tbClose();
+int tbProbe(char board[BOARD_SIZE][BOARD_SIZE], char color);
+int tbGenerate(const char* dir, const char* name);
+
+#endif /* TABLEBASE_H_ */
@@ -0,0 +1,29 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 tables.h                                     */
+/* contents: attack tables generated at build time        */
+/**********************************************************/
+#include "chessprog.h"
+#ifndef TABLES_H_
+#define TABLES_H_
+
+/* Masks of squares (bit toSquare(col,row), see scan.h) by the square a piece stands on. They are written
+ * to tables.c by gentables when the engine is built (see makefile), tables.c isn't edited by hand. */
+
+#define TABLE_SQUARES (BOARD_SIZE*BOARD_SIZE)
+
+/*directions a rook (first 4) and a bishop (last 4) slide in, rays is generated from this same table*/
+static const int pieceSteps[8][2] = {{1,0}, {-1,0}, {0,1}, {0,-1}, {1,1}, {1,-1}, {-1,1}, {-1,-1}};
+
+/* square index step of direction d of pieceSteps, rays with a positive step run to higher squares */
+#define rayStep(D) (pieceSteps[D][0]*BOARD_SIZE+pieceSteps[D][1])
+
+extern const unsigned long long knightAttacks[TABLE_SQUARES]; /*squares a knight jumps to*/
+extern const unsigned long long kingAttacks[TABLE_SQUARES]; /*squares next to the square*/
+extern const unsigned long long pawnAttacks[2][TABLE_SQUARES]; /*squares a white (0) or black (1) pawn attacks*/
+extern const unsigned long long rays[8][TABLE_SQUARES]; /*by direction of pieceSteps, squares up to the edge*/
+
+#endif /* TABLES_H_ */
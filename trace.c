@@ -0,0 +1,78 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 trace.c                                      */
+/* contents: binary trace of minimax nodes                */
+/**********************************************************/
+#include "trace.h"
+
+THREAD_LOCAL FILE* traceFile = NULL;
+static THREAD_LOCAL traceRec_t* traceBuf = NULL; /*ring of TRACE_BUF_SIZE records, written out when full*/
+static THREAD_LOCAL unsigned traceLen = 0;
+
+/* start tracing this thread's searches into a new file at path (replaces an open trace)
+ * @post: return 0 on success, -1 if the file can't be written or on allocation error */
+int traceOpen(const char* path) {
+	traceHeader_t header = {TRACE_MAGIC, TRACE_VERSION, sizeof(traceRec_t), {0, 0}};
+
+	traceClose();
+	if ((traceBuf = (traceRec_t*)malloc(TRACE_BUF_SIZE*sizeof(traceRec_t))) == NULL)
+		return -1;
+	if ((traceFile = fopen(path, "wb")) == NULL || fwrite(&header, sizeof(header), 1, traceFile) != 1) {
+		traceClose();
+		return -1;
+	}
+	return 0;
+}
+
+/* write out all records and stop tracing */
+void traceClose() {
+	if (traceFile != NULL) {
+		traceFlush();
+		fclose(traceFile);
+	}
+	free(traceBuf);
+	traceFile = NULL;
+	traceBuf = NULL;
+	traceLen = 0;
+}
+
+/* write buffered records to the trace file, tracing stops on a write error */
+void traceFlush() {
+	if (traceFile == NULL)
+		return;
+	if (traceLen != 0 && fwrite(traceBuf, sizeof(traceRec_t), traceLen, traceFile) != traceLen) {
+		fclose(traceFile);
+		traceFile = NULL; /*disk full or similar, drop the trace rather than the game*/
+	}
+	traceLen = 0;
+}
+
+/* append a record, use through the TRACE macro
+ * @pre: traceFile != NULL */
+void traceWrite(char type, int depth, move_t* move, unsigned index, unsigned moves, int alpha, int beta, int score) {
+	traceRec_t* rec;
+
+	if (traceLen == TRACE_BUF_SIZE)
+		traceFlush();
+	if (traceFile == NULL)
+		return;
+	rec = &traceBuf[traceLen++];
+	rec->type = type;
+	rec->depth = depth;
+	if (move != NULL) {
+		rec->from = move->curr.col*BOARD_SIZE + move->curr.row;
+		rec->to = move->next->curr.col*BOARD_SIZE + move->next->curr.row;
+		rec->special = move->special;
+	} else {
+		rec->from = rec->to = TRACE_NO_SQUARE;
+		rec->special = NORM;
+	}
+	rec->index = index>UCHAR_MAX? UCHAR_MAX:index;
+	rec->moves = moves;
+	rec->alpha = alpha;
+	rec->beta = beta;
+	rec->score = score;
+}
@@ -0,0 +1,53 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 trace.h                                      */
+/* contents: binary trace of minimax nodes                */
+/**********************************************************/
+#include "chessprog.h"
+#include <limits.h>
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#define TRACE_MAGIC "CNTR" /*first bytes of a trace file*/
+#define TRACE_VERSION 1
+#define TRACE_BUF_SIZE 4096 /*records kept in memory between writes*/
+
+#define TRACE_ENTER 'e' /*node entered, with its window*/
+#define TRACE_EXIT 'x' /*node left, with its score, best move and moves searched*/
+#define TRACE_CUTOFF 'c' /*alpha-beta pruning, with the move that caused it*/
+
+#define TRACE_NO_SQUARE 0xff /*move field of a record that has no move*/
+
+typedef struct { /*trace file header*/
+	char magic[4];
+	unsigned char version;
+	unsigned char recordSize; /*sizeof(traceRec_t) of the writer, checked by the reader*/
+	unsigned char pad[2];
+} traceHeader_t;
+
+typedef struct { /*single trace record, fields not used by a record type are 0*/
+	unsigned char type; /*TRACE_ENTER, TRACE_EXIT or TRACE_CUTOFF*/
+	unsigned char depth; /*plies from the root*/
+	unsigned char from, to; /*squares as col*BOARD_SIZE+row, TRACE_NO_SQUARE if none*/
+	char special;
+	unsigned char index; /*exit: moves searched, cutoff: index of the cutting move (0 is first)*/
+	unsigned short moves; /*legal moves generated in the node*/
+	int alpha, beta;
+	int score;
+} traceRec_t;
+
+/*tracing is enabled for a thread iff its traceFile is not NULL, so a disabled trace costs a single compare*/
+extern THREAD_LOCAL FILE* traceFile;
+
+#define TRACE(type, depth, move, index, moves, alpha, beta, score) \
+	do { if (traceFile != NULL) traceWrite(type, depth, move, index, moves, alpha, beta, score); } while (0)
+
+int traceOpen(const char* path);
+void traceClose();
+void traceFlush();
+void traceWrite(char type, int depth, move_t* move, unsigned index, unsigned moves, int alpha, int beta, int score);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,94 @@
+/**********************************************************/
+/*                     THE CHESSNUT                       */
+/* Authors: Sivan Schick, sivanschick@mail.tau.ac.il      */
+/*			Zohar Meir,   zoharmeir1@mail.tau.ac.il       */
+/*														  */
+/* file:	 tracesum.c                                   */
+/* contents: offline summary of a minimax trace file      */
+/**********************************************************/
+#include "trace.h"
+
+#define MAX_TRACE_DEPTH 256 /*depth field is a byte*/
+
+typedef struct { /*totals for all nodes at one depth*/
+	unsigned long nodes; /*entered*/
+	unsigned long leaves; /*left without searching any move*/
+	unsigned long generated; /*moves generated in inner nodes*/
+	unsigned long searched; /*moves searched in inner nodes*/
+	unsigned long cutoffs;
+	unsigned long firstCutoffs;
+	unsigned long cutoffSearched; /*moves searched in nodes that were cut off*/
+	unsigned long cutoffGenerated; /*moves generated in nodes that were cut off*/
+} depthSum_t;
+
+/* read trace file given as the only argument and print pruning efficiency per depth
+ * @post: return 0 on success, 1 on usage, file or format error */
+int main(int argc, char* argv[]) {
+	static depthSum_t sums[MAX_TRACE_DEPTH];
+	traceHeader_t header;
+	traceRec_t rec;
+	depthSum_t* d;
+	unsigned long records = 0;
+	int maxDepth = -1;
+	FILE* fp;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <trace file>\n", argv[0]);
+		return 1;
+	}
+	if ((fp = fopen(argv[1], "rb")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	if (fread(&header, sizeof(header), 1, fp) != 1 || strncmp(header.magic, TRACE_MAGIC, 4) != 0 || \
+			header.version != TRACE_VERSION || header.recordSize != sizeof(traceRec_t)) {
+		fprintf(stderr, "%s: not a trace file of this version\n", argv[1]);
+		fclose(fp);
+		return 1;
+	}
+
+	while (fread(&rec, sizeof(rec), 1, fp) == 1) {
+		records++;
+		d = &sums[rec.depth];
+		maxDepth = rec.depth>maxDepth? rec.depth:maxDepth;
+		switch (rec.type) {
+			case TRACE_ENTER:
+				d->nodes++;
+				break;
+			case TRACE_EXIT:
+				if (rec.moves == 0) {
+					d->leaves++;
+				} else {
+					d->generated += rec.moves;
+					d->searched += rec.index;
+				}
+				break;
+			case TRACE_CUTOFF:
+				d->cutoffs++;
+				if (rec.index == 0)
+					d->firstCutoffs++;
+				d->cutoffSearched += rec.index+1;
+				d->cutoffGenerated += rec.moves;
+				break;
+		}
+	}
+	fclose(fp);
+
+	printf("%lu records\n", records);
+	printf("%5s %10s %10s %10s %8s %8s %12s %12s\n", "depth", "nodes", "leaves", "cutoffs", \
+			"cut%", "first%", "searched/gen", "at cutoff");
+	for (int i=0 ; i<=maxDepth ; i++) {
+		d = &sums[i];
+		if (d->nodes == 0)
+			continue;
+		printf("%5d %10lu %10lu %10lu %7.1f%% %7.1f%% %5.2f/%-6.2f %5.2f/%-6.2f\n", i, d->nodes, d->leaves, \
+				d->cutoffs, \
+				d->nodes>d->leaves? 100.0*d->cutoffs/(d->nodes-d->leaves):0.0, \
+				d->cutoffs? 100.0*d->firstCutoffs/d->cutoffs:0.0, \
+				d->nodes>d->leaves? (double)d->searched/(d->nodes-d->leaves):0.0, \
+				d->nodes>d->leaves? (double)d->generated/(d->nodes-d->leaves):0.0, \
+				d->cutoffs? (double)d->cutoffSearched/d->cutoffs:0.0, \
+				d->cutoffs? (double)d->cutoffGenerated/d->cutoffs:0.0);
+	}
+	return 0;
+}